@@ -0,0 +1,326 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "ergasia2.h"
+#include "simulator.h"
+#include "sweep.h"
+
+/* Benchmark of the simulator core. Synthetic traces (in the text format of bzip.trace and gcc.trace) are
+   generated from a fixed seed, so every run (and every commit) measures the exact same references. Each
+   measurement runs in a child process, so its peak RSS is its own. */
+
+#define BENCH_SEED 0x2545F4914F6CDD1DULL  /* Every trace is generated from this seed (and its workload and process) */
+#define BENCH_NUM_OF_PROCESSES 2  /* Like bzip and gcc */
+#define BENCH_WRITE_PERCENT 25  /* The share of references that write */
+#define CALIBRATION_ROUNDS 1000000  /* Clock reads used to measure the cost of reading the clock */
+
+typedef enum Workload {  /* The access pattern of a synthetic trace */
+    WORKLOAD_UNIFORM,  /* Every page of a range is equally likely */
+    WORKLOAD_ZIPF,  /* A few pages get most of the references (exponent 0.99) */
+    WORKLOAD_LOOP,  /* The pages of a range are scanned in order, again and again */
+    WORKLOAD_PHASES,  /* Uniform over a small working set that moves to other pages a few times */
+    NUM_OF_WORKLOADS
+} Workload;
+
+static const char *workload_names[] = {"uniform", "zipf", "loop", "phases"};  /* Indexed by Workload */
+
+typedef struct Bench_Options_Type {
+    long long num_of_references;  /* Per process */
+    int repeat;  /* Each throughput is the best of this many runs */
+    int *frames;  /* The values of num_of_frames */
+    int num_of_frames_values;
+    Algorithm algorithms[NUM_OF_ALGORITHMS];
+    int num_of_algorithms;
+    const char *directory;  /* Where the traces are generated */
+} Bench_Options;
+
+static uint64_t Random_Next(uint64_t *state) {  /* splitmix64: a small generator that gives the same numbers on every platform */
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static int Random_Below(uint64_t *state, int bound) {  /* Uniform in [0, bound) */
+    return (int)(Random_Next(state) % (uint64_t)bound);
+}
+
+static long long Now_Nanoseconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+static int Generate_Trace(const char *path, Workload workload, int pid, long long num_of_references) {  /* Write a synthetic trace (OK or ERROR) */
+    FILE *file = fopen(path, "w");
+    if (file == NULL)
+        return ERROR;
+    uint64_t state = BENCH_SEED ^ ((uint64_t)workload << 32) ^ (uint64_t)pid;
+    int num_of_pages = 0;
+    double *cumulative = NULL;  /* The Zipf distribution function (ZIPF only) */
+    switch (workload) {
+        case WORKLOAD_UNIFORM: num_of_pages = 4096; break;
+        case WORKLOAD_ZIPF: num_of_pages = 16384; break;
+        case WORKLOAD_LOOP: num_of_pages = 600; break;
+        case WORKLOAD_PHASES: num_of_pages = 256; break;  /* The size of the working set of each phase */
+        default: break;
+    }
+    if (workload == WORKLOAD_ZIPF) {
+        cumulative = (double *)malloc(num_of_pages * sizeof(double));
+        if (cumulative == NULL) {
+            fclose(file);
+            return ERROR;
+        }
+        double sum = 0;
+        for (int rank = 0; rank < num_of_pages; rank++) {
+            sum += 1.0 / pow(rank + 1, 0.99);
+            cumulative[rank] = sum;
+        }
+        for (int rank = 0; rank < num_of_pages; rank++) {
+            cumulative[rank] /= sum;
+        }
+    }
+    int phase_base = 0;
+    for (long long i = 0; i < num_of_references; i++) {
+        int page;
+        switch (workload) {
+            case WORKLOAD_ZIPF: {  /* Invert the distribution function by binary search */
+                double u = (Random_Next(&state) >> 11) * (1.0 / 9007199254740992.0);
+                int low = 0, high = num_of_pages - 1;
+                while (low < high) {
+                    int middle = (low + high) / 2;
+                    if (cumulative[middle] < u)
+                        low = middle + 1;
+                    else
+                        high = middle;
+                }
+                page = (low * 2654435761u) % 1048576;  /* Scatter the ranks over the address space */
+                break;
+            }
+            case WORKLOAD_LOOP:
+                page = 1000 + (int)(i % num_of_pages);
+                break;
+            case WORKLOAD_PHASES:
+                if (i % (num_of_references / 8 + 1) == 0)  /* Eight phases, each on other pages */
+                    phase_base = Random_Below(&state, 65536 - num_of_pages);
+                page = phase_base + Random_Below(&state, num_of_pages);
+                break;
+            default:
+                page = Random_Below(&state, num_of_pages);
+                break;
+        }
+        int offset = Random_Below(&state, FRAME_SIZE);
+        char action = (Random_Below(&state, 100) < BENCH_WRITE_PERCENT) ? 'W' : 'R';
+        fprintf(file, "%08x %c\n", (unsigned int)page * FRAME_SIZE + offset, action);
+    }
+    free(cumulative);
+    return (fclose(file) == 0) ? OK : ERROR;
+}
+
+static double Clock_Overhead(void) {  /* The cost of a pair of clock reads, which is subtracted from each timed reference */
+    long long start = Now_Nanoseconds();
+    long long sink = 0;
+    for (int i = 0; i < CALIBRATION_ROUNDS; i++) {
+        long long before = Now_Nanoseconds();
+        sink += Now_Nanoseconds() - before;
+    }
+    (void)sink;
+    return (double)(Now_Nanoseconds() - start) / CALIBRATION_ROUNDS / 2;  /* Each round reads the clock twice, like one timed reference */
+}
+
+static int Measure(const char **trace_paths, Trace_Data *traces, Workload workload, Algorithm algorithm, int num_of_frames, const Bench_Options *options, double clock_overhead) {  /* Time one configuration and print its row (OK or ERROR) */
+    Simulator_Config config;
+    memset(&config, 0, sizeof(config));
+    config.algorithm = algorithm;
+    config.num_of_frames = num_of_frames;
+    config.q = 1;
+    config.ws_size = (num_of_frames / 4 > 1) ? num_of_frames / 4 : 1;  /* Small enough for both working sets to fit */
+    config.max_num_of_references = INVALID;
+    Address_Layout_Init(&config.layout, FRAME_SIZE, LOGICAL_ADDRESS_BITS);
+    config.trace_paths = trace_paths;
+    config.num_of_processes = BENCH_NUM_OF_PROCESSES;
+    config.verbosity = VERBOSITY_SUMMARY;
+    config.sample_interval = 1;
+    config.events = NULL;
+    config.preloaded = traces;  /* Parsing is not part of the measurement */
+    Simulator sim;
+
+    /* Throughput: the whole run, best of a few */
+    double best_seconds = 0;
+    for (int run = 0; run < options->repeat; run++) {
+        if (Simulator_Create(&sim, &config) != OK) {
+            printf("%s\n", sim.error);
+            Simulator_Destroy(&sim);
+            return ERROR;
+        }
+        long long start = Now_Nanoseconds();
+        int status = Simulator_Run(&sim);
+        double seconds = (Now_Nanoseconds() - start) / 1e9;
+        if (status != OK) {
+            printf("%s\n", sim.error);
+            Simulator_Destroy(&sim);
+            return ERROR;
+        }
+        if (run == 0 || seconds < best_seconds)
+            best_seconds = seconds;
+        Simulator_Destroy(&sim);
+    }
+
+    /* Latency: each reference timed on its own, split into hits and faults */
+    if (Simulator_Create(&sim, &config) != OK) {
+        printf("%s\n", sim.error);
+        Simulator_Destroy(&sim);
+        return ERROR;
+    }
+    long long hit_nanoseconds = 0, fault_nanoseconds = 0, hits = 0;
+    int pid;
+    const Reference *reference;
+    while ((reference = Simulator_Next_Reference(&sim, &pid)) != NULL) {
+        long long loads = sim.load_count;
+        long long before = Now_Nanoseconds();
+        if (Simulator_Resolve_Reference(&sim, pid, reference) != OK) {
+            printf("%s\n", sim.error);
+            Simulator_Destroy(&sim);
+            return ERROR;
+        }
+        long long elapsed = Now_Nanoseconds() - before;
+        if (sim.load_count == loads) {
+            hit_nanoseconds += elapsed;
+            hits++;
+        }
+        else
+            fault_nanoseconds += elapsed;
+    }
+    long long faults = sim.load_count;
+    double ns_per_hit = (hits > 0) ? (double)hit_nanoseconds / hits - clock_overhead : 0;
+    double ns_per_fault = (faults > 0) ? (double)fault_nanoseconds / faults - clock_overhead : 0;
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    printf("%s,%s,%d,", workload_names[workload], Algorithm_Name(algorithm), num_of_frames);
+    if (Algorithm_Uses_Working_Sets(algorithm))
+        printf("%d", config.ws_size);
+    printf(",%lld,%lld,%.0f,%.1f,%.1f,%ld\n", sim.reference_count, faults, sim.reference_count / best_seconds, ns_per_hit > 0 ? ns_per_hit : 0, ns_per_fault > 0 ? ns_per_fault : 0, usage.ru_maxrss);
+    Simulator_Destroy(&sim);
+    return OK;
+}
+
+static int Run_In_Child(const char **trace_paths, Workload workload, Algorithm algorithm, int num_of_frames, const Bench_Options *options, double clock_overhead) {  /* Measure in a fresh process, so the peak RSS belongs to this configuration only */
+    fflush(stdout);
+    pid_t child = fork();
+    if (child < 0)
+        return ERROR;
+    if (child == 0) {
+        Trace_Data traces[BENCH_NUM_OF_PROCESSES];
+        memset(traces, 0, sizeof(traces));
+        Address_Layout layout;
+        Address_Layout_Init(&layout, FRAME_SIZE, LOGICAL_ADDRESS_BITS);
+        int status = OK;
+        for (int pid = 0; pid < BENCH_NUM_OF_PROCESSES && status == OK; pid++) {
+            if (Trace_Load(&traces[pid], trace_paths[pid], &layout) != OK) {
+                printf("Could not read file %s\n", trace_paths[pid]);
+                status = ERROR;
+            }
+        }
+        if (status == OK)
+            status = Measure(trace_paths, traces, workload, algorithm, num_of_frames, options, clock_overhead);
+        for (int pid = 0; pid < BENCH_NUM_OF_PROCESSES; pid++) {
+            Trace_Unload(&traces[pid]);
+        }
+        fflush(stdout);
+        _exit(status == OK ? 0 : 1);
+    }
+    int child_status;
+    if (waitpid(child, &child_status, 0) != child || !WIFEXITED(child_status) || WEXITSTATUS(child_status) != 0)
+        return ERROR;
+    return OK;
+}
+
+static int Parse_Bench_Options(int argc, char *argv[], Bench_Options *options) {  /* OK, or ERROR for an unknown or invalid option */
+    options->num_of_references = 200000;
+    options->repeat = 3;
+    options->frames = NULL;
+    options->num_of_algorithms = 0;
+    options->directory = "bench_traces";
+    const char *frames = "64,512";
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--references=", 13) == 0)
+            options->num_of_references = atoll(argv[i] + 13);
+        else if (strncmp(argv[i], "--repeat=", 9) == 0)
+            options->repeat = atoi(argv[i] + 9);
+        else if (strncmp(argv[i], "--frames=", 9) == 0)
+            frames = argv[i] + 9;
+        else if (strncmp(argv[i], "--dir=", 6) == 0)
+            options->directory = argv[i] + 6;
+        else if (strncmp(argv[i], "--algorithms=", 13) == 0) {
+            char *names = strdup(argv[i] + 13);
+            for (char *name = strtok(names, ","); name != NULL; name = strtok(NULL, ",")) {
+                int algorithm = Algorithm_From_Name(name);
+                if (algorithm == INVALID || options->num_of_algorithms == NUM_OF_ALGORITHMS) {
+                    free(names);
+                    return ERROR;
+                }
+                options->algorithms[options->num_of_algorithms++] = (Algorithm)algorithm;
+            }
+            free(names);
+        }
+        else
+            return ERROR;
+    }
+    if (options->num_of_algorithms == 0) {  /* Every policy by default */
+        for (int algorithm = 0; algorithm < NUM_OF_ALGORITHMS; algorithm++) {
+            options->algorithms[options->num_of_algorithms++] = (Algorithm)algorithm;
+        }
+    }
+    if (Sweep_Parse_List(frames, &options->frames, &options->num_of_frames_values) != OK || options->num_of_references < 1 || options->repeat < 1)
+        return ERROR;
+    return OK;
+}
+
+int main(int argc, char *argv[]) {
+    Bench_Options options;
+    if (Parse_Bench_Options(argc, argv, &options) != OK) {
+        printf("Usage: ./benchmark [--references=<per_process>] [--repeat=<n>] [--frames=<list>] [--algorithms=<list>] [--dir=<directory>]\n");
+        free(options.frames);
+        return ERROR;
+    }
+    mkdir(options.directory, 0755);  /* It may exist already */
+
+    /* The same traces for the same options, whenever they are generated */
+    char paths[NUM_OF_WORKLOADS][BENCH_NUM_OF_PROCESSES][256];
+    for (int workload = 0; workload < NUM_OF_WORKLOADS; workload++) {
+        for (int pid = 0; pid < BENCH_NUM_OF_PROCESSES; pid++) {
+            snprintf(paths[workload][pid], sizeof(paths[workload][pid]), "%s/%s%d.trace", options.directory, workload_names[workload], pid + 1);
+            if (Generate_Trace(paths[workload][pid], (Workload)workload, pid, options.num_of_references) != OK) {
+                printf("Could not create file %s\n", paths[workload][pid]);
+                free(options.frames);
+                return ERROR;
+            }
+        }
+    }
+
+    double clock_overhead = Clock_Overhead();
+    printf("# %lld references per process, %d processes, q = 1, best of %d runs, clock overhead %.1f ns\n", options.num_of_references, BENCH_NUM_OF_PROCESSES, options.repeat, clock_overhead);
+    printf("workload,algorithm,frames,ws_size,references,page_faults,references_per_sec,ns_per_hit,ns_per_fault,peak_rss_kb\n");
+    int status = OK;
+    for (int workload = 0; workload < NUM_OF_WORKLOADS && status == OK; workload++) {
+        const char *trace_paths[BENCH_NUM_OF_PROCESSES];
+        for (int pid = 0; pid < BENCH_NUM_OF_PROCESSES; pid++) {
+            trace_paths[pid] = paths[workload][pid];
+        }
+        for (int a = 0; a < options.num_of_algorithms && status == OK; a++) {
+            for (int f = 0; f < options.num_of_frames_values && status == OK; f++) {
+                status = Run_In_Child(trace_paths, (Workload)workload, options.algorithms[a], options.frames[f], &options, clock_overhead);
+            }
+        }
+    }
+    free(options.frames);
+    return status;
+}
@@ -0,0 +1,202 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "ergasia2.h"
+#include "checkpoint.h"
+#include "policy.h"
+
+typedef struct Checkpoint_Header_Type {  /* The first bytes of a checkpoint (64, without padding) */
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;  /* CHECKPOINT_BYTE_ORDER as the writer stored it */
+    int32_t algorithm;
+    int32_t lru_scan;
+    int32_t num_of_frames;
+    int32_t q;
+    int32_t ws_size;
+    int32_t offset_bits;
+    int32_t address_bits;
+    int32_t num_of_processes;
+    int32_t num_of_free_frames;
+    int32_t num_of_active;
+    int32_t turn;
+    int32_t quantum_used;
+    int64_t reference_count;
+    int64_t load_count;
+    int64_t save_count;
+} Checkpoint_Header;
+
+bool Checkpoint_Write(FILE *file, const void *data, size_t size) {  /* Write size bytes of state (TRUE on success) */
+    return (fwrite(data, 1, size, file) == size);
+}
+
+bool Checkpoint_Read(FILE *file, void *data, size_t size) {  /* Read size bytes of state (TRUE on success) */
+    return (fread(data, 1, size, file) == size);
+}
+
+int Checkpoint_Save(Simulator *sim, const char *path) {  /* Write the state of a simulation (OK, or ERROR with the reason in sim->error) */
+    FILE *file = fopen(path, "wb");
+    if (file == NULL)
+        return Simulator_Fail(sim, "Could not create file %s", path);
+    Checkpoint_Header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CHECKPOINT_MAGIC, 8);
+    header.version = CHECKPOINT_VERSION;
+    header.byte_order = CHECKPOINT_BYTE_ORDER;
+    header.algorithm = sim->config.algorithm;
+    header.lru_scan = sim->config.lru_scan;
+    header.num_of_frames = sim->config.num_of_frames;
+    header.q = sim->config.q;
+    header.ws_size = sim->config.ws_size;
+    header.offset_bits = sim->config.layout.offset_bits;
+    header.address_bits = sim->config.layout.address_bits;
+    header.num_of_processes = sim->num_of_processes;
+    header.num_of_free_frames = sim->num_of_free_frames;
+    header.num_of_active = sim->num_of_active;
+    header.turn = sim->turn;
+    header.quantum_used = sim->quantum_used;
+    header.reference_count = sim->reference_count;
+    header.load_count = sim->load_count;
+    header.save_count = sim->save_count;
+
+    IPT_Table *IPT = &sim->IPT;
+    size_t num_of_frames = sim->config.num_of_frames;
+    size_t bitmap_words = (num_of_frames + 63) / 64;
+    bool written = Checkpoint_Write(file, &header, sizeof(header))
+        && Checkpoint_Write(file, IPT->page_nums, num_of_frames * sizeof(uint64_t))
+        && Checkpoint_Write(file, IPT->pids, num_of_frames * sizeof(int))
+        && Checkpoint_Write(file, IPT->timestamps, num_of_frames * sizeof(long long))
+        && Checkpoint_Write(file, IPT->valid, bitmap_words * sizeof(uint64_t))
+        && Checkpoint_Write(file, IPT->modified, bitmap_words * sizeof(uint64_t))
+        && Checkpoint_Write(file, IPT->lru_prev, num_of_frames * sizeof(int))
+        && Checkpoint_Write(file, IPT->lru_next, num_of_frames * sizeof(int))
+        && Checkpoint_Write(file, sim->free_frames, sim->num_of_free_frames * sizeof(int))
+        && Checkpoint_Write(file, sim->active, sim->num_of_active * sizeof(int));
+    for (int pid = 0; written && pid < sim->num_of_processes; pid++) {
+        Process *process = &sim->processes[pid];
+        written = Checkpoint_Write(file, process->name, sizeof(process->name))  /* To catch traces given in another order */
+            && Checkpoint_Write(file, &process->page_faults, sizeof(long long))
+            && Checkpoint_Write(file, &process->references, sizeof(long long));  /* Also its position in its trace */
+    }
+    if (written)
+        written = (sim->policy->save(sim, file) == OK);
+    if (fclose(file) != 0)
+        written = FALSE;
+    if (!written)
+        return Simulator_Fail(sim, "Could not write file %s", path);
+    return OK;
+}
+
+static int Checkpoint_Mismatch(Simulator *sim, const char *path, const char *what) {  /* The checkpoint does not fit the given configuration */
+    return Simulator_Fail(sim, "Checkpoint %s was taken with a different %s", path, what);
+}
+
+static bool Checkpoint_Frames_Valid(const int *frames, size_t length, int num_of_frames) {  /* Whether every entry is a frame or INVALID */
+    for (size_t i = 0; i < length; i++) {
+        if (frames[i] < INVALID || frames[i] >= num_of_frames)
+            return FALSE;
+    }
+    return TRUE;
+}
+
+static int Checkpoint_Restore(Simulator *sim, FILE *file, const char *path) {  /* Read a checkpoint onto the simulation (OK, or ERROR with the reason in sim->error) */
+    Checkpoint_Header header;
+    if (!Checkpoint_Read(file, &header, sizeof(header)) || memcmp(header.magic, CHECKPOINT_MAGIC, 8) != 0)
+        return Simulator_Fail(sim, "%s is not a checkpoint", path);
+    if (header.version != CHECKPOINT_VERSION)
+        return Simulator_Fail(sim, "Checkpoint %s has unsupported version %u", path, header.version);
+    if (header.byte_order != CHECKPOINT_BYTE_ORDER)
+        return Simulator_Fail(sim, "Checkpoint %s was written on a machine of another byte order", path);
+
+    /* What the state depends on has to be the same */
+    if (header.algorithm != (int32_t)sim->config.algorithm)
+        return Checkpoint_Mismatch(sim, path, "algorithm");
+    if (header.lru_scan != sim->config.lru_scan && sim->config.algorithm == ALGORITHM_LRU)
+        return Checkpoint_Mismatch(sim, path, "LRU victim selection");
+    if (header.num_of_frames != sim->config.num_of_frames)
+        return Checkpoint_Mismatch(sim, path, "number of frames");
+    if (header.ws_size != sim->config.ws_size && Algorithm_Uses_Working_Sets(sim->config.algorithm))
+        return Checkpoint_Mismatch(sim, path, "working set size");
+    if (header.offset_bits != sim->config.layout.offset_bits)
+        return Checkpoint_Mismatch(sim, path, "page size");
+    if (header.address_bits != sim->config.layout.address_bits)
+        return Checkpoint_Mismatch(sim, path, "address width");
+    if (header.num_of_processes != sim->num_of_processes)
+        return Checkpoint_Mismatch(sim, path, "number of processes");
+    if (header.q != sim->config.q && sim->policy->needs_future)
+        return Checkpoint_Mismatch(sim, path, "q (the future of the references depends on it)");
+
+    IPT_Table *IPT = &sim->IPT;
+    int num_of_frames = sim->config.num_of_frames;
+    size_t bitmap_words = ((size_t)num_of_frames + 63) / 64;
+    if (header.num_of_free_frames < 0 || header.num_of_free_frames > num_of_frames || header.num_of_active < 0 || header.num_of_active > sim->num_of_processes || header.turn < 0 || (header.turn > 0 && header.turn >= header.num_of_active) || header.quantum_used < 0)
+        return Simulator_Fail(sim, "Checkpoint %s is corrupt", path);
+    bool read = Checkpoint_Read(file, IPT->page_nums, num_of_frames * sizeof(uint64_t))
+        && Checkpoint_Read(file, IPT->pids, num_of_frames * sizeof(int))
+        && Checkpoint_Read(file, IPT->timestamps, num_of_frames * sizeof(long long))
+        && Checkpoint_Read(file, IPT->valid, bitmap_words * sizeof(uint64_t))
+        && Checkpoint_Read(file, IPT->modified, bitmap_words * sizeof(uint64_t))
+        && Checkpoint_Read(file, IPT->lru_prev, num_of_frames * sizeof(int))
+        && Checkpoint_Read(file, IPT->lru_next, num_of_frames * sizeof(int))
+        && Checkpoint_Read(file, sim->free_frames, header.num_of_free_frames * sizeof(int))
+        && Checkpoint_Read(file, sim->active, header.num_of_active * sizeof(int));
+    for (int pid = 0; read && pid < sim->num_of_processes; pid++) {
+        Process *process = &sim->processes[pid];
+        char name[sizeof(process->name)];
+        read = Checkpoint_Read(file, name, sizeof(name))
+            && Checkpoint_Read(file, &process->page_faults, sizeof(long long))
+            && Checkpoint_Read(file, &process->references, sizeof(long long));
+        if (read && strncmp(name, process->name, sizeof(name)) != 0) {
+            name[sizeof(name) - 1] = '\0';
+            return Simulator_Fail(sim, "Checkpoint %s has process %s where %s was given", path, name, process->name);
+        }
+    }
+    if (!read)
+        return Simulator_Fail(sim, "Checkpoint %s is truncated", path);
+    for (int frame = 0; frame < num_of_frames; frame++) {  /* Everything that serves as an index has to be in range */
+        if (Bitmap_Test(IPT->valid, frame) && (IPT->pids[frame] < 0 || IPT->pids[frame] >= sim->num_of_processes))
+            return Simulator_Fail(sim, "Checkpoint %s is corrupt", path);
+    }
+    if (!Checkpoint_Frames_Valid(IPT->lru_prev, num_of_frames, num_of_frames) || !Checkpoint_Frames_Valid(IPT->lru_next, num_of_frames, num_of_frames) || !Checkpoint_Frames_Valid(sim->free_frames, header.num_of_free_frames, num_of_frames))
+        return Simulator_Fail(sim, "Checkpoint %s is corrupt", path);
+    for (int i = 0; i < header.num_of_active; i++) {
+        if (sim->active[i] < 0 || sim->active[i] >= sim->num_of_processes)
+            return Simulator_Fail(sim, "Checkpoint %s is corrupt", path);
+    }
+    sim->num_of_free_frames = header.num_of_free_frames;
+    sim->num_of_active = header.num_of_active;
+    sim->turn = header.turn;
+    sim->quantum_used = header.quantum_used;
+    sim->reference_count = header.reference_count;
+    sim->load_count = header.load_count;
+    sim->save_count = header.save_count;
+    Simulator_Rehash(sim);  /* The chains are not stored, lookups find the same frames through new ones */
+    if (sim->policy->load(sim, file) != OK || fgetc(file) != EOF)  /* Nothing may be left over either */
+        return Simulator_Fail(sim, "Checkpoint %s is truncated or corrupt", path);
+
+    /* Each process that is still in the round robin continues right after its last resolved reference */
+    for (int i = 0; i < sim->num_of_active; i++) {
+        Process *process = &sim->processes[sim->active[i]];
+        bool positioned;
+        if (process->preloaded != NULL) {
+            positioned = (process->references <= process->num_of_preloaded);
+            process->next_preloaded = process->references;
+        }
+        else
+            positioned = (Trace_Seek(process->reader, process->references) == OK);
+        if (!positioned)
+            return Simulator_Fail(sim, "The trace of %s is shorter than checkpoint %s expects", process->name, path);
+    }
+    return OK;
+}
+
+int Checkpoint_Load(Simulator *sim, const char *path) {  /* Continue a freshly created simulation from a checkpoint of the same configuration and traces (OK, or ERROR with the reason in sim->error) */
+    FILE *file = fopen(path, "rb");
+    if (file == NULL)
+        return Simulator_Fail(sim, "Could not open file %s", path);
+    int status = Checkpoint_Restore(sim, file, path);
+    fclose(file);
+    return status;
+}
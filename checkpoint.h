@@ -0,0 +1,29 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "simulator.h"
+
+/* Snapshot of a whole simulation between two references, so it can be resumed later and continue exactly as
+   if it had never stopped. One warmed-up state can then be forked into runs that differ in what the snapshot
+   does not fix: the max number of references, q (except for OPT), the verbosity, the events and the payload.
+
+   The file starts with a header (magic "IPTSTATE", u32 version, u32 byte order mark and the configuration the
+   snapshot belongs to), followed by the arrays of the IPT, the free frames, every process (name, counters and
+   position in its trace), the round robin and then whatever the policy keeps. The arrays are written as they
+   are in memory, so a checkpoint is resumed on a machine of the same byte order (the mark is checked).
+   The traces are not part of it: they are given again and each one continues after its last resolved
+   reference. Neither are the contents of the frames (--payload=lazy), which only mark what was written. */
+
+#define CHECKPOINT_MAGIC "IPTSTATE"
+#define CHECKPOINT_VERSION 1
+#define CHECKPOINT_BYTE_ORDER 0x01020304  /* Reads back differently on a machine of another byte order */
+
+int Checkpoint_Save(Simulator *sim, const char *path);  /* Write the state of a simulation (OK, or ERROR with the reason in sim->error) */
+int Checkpoint_Load(Simulator *sim, const char *path);  /* Continue a freshly created simulation from a checkpoint of the same configuration and traces (OK, or ERROR with the reason in sim->error) */
+bool Checkpoint_Write(FILE *file, const void *data, size_t size);  /* Write size bytes of state (TRUE on success) */
+bool Checkpoint_Read(FILE *file, void *data, size_t size);  /* Read size bytes of state (TRUE on success) */
+
+#endif
@@ -2,424 +2,423 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
-#include <math.h>
+#include "ergasia2.h"
+#include "trace.h"
+#include "events.h"
+#include "simulator.h"
+#include "checkpoint.h"
+#include "metrics.h"
+#include "sweep.h"
+#include "mrc.h"
 
-#define FRAME_SIZE 4096
-#define LOGICAL_ADDRESS_BITS 32
-#define OFFSET_BITS Logarithm(FRAME_SIZE, 2)  /* Offset must be able to specify each byte of a frame */
-#define PAGE_NUM_BITS (LOGICAL_ADDRESS_BITS - OFFSET_BITS)  /* The rest of a logical address (besides offset) is the page number */
-#define BUFFER_SIZE Bit_Size_To_Hex_Size(LOGICAL_ADDRESS_BITS) + 2  /* The logical address is followed by a space and a character (given reference format) */
-#define NUM_OF_FILES 2
-#define OK 0
-#define ERROR !OK
-#define INVALID -1
-#define FALSE 0
-#define TRUE !FALSE
+#define DEFAULT_NUM_OF_FILES 2  /* Without --trace options, bzip and gcc are simulated */
+#define OUTPUT_BUFFER_SIZE (1 << 20)  /* Standard output is written in blocks of this size, even when it is a terminal */
 
 #define GIVE_INSTRUCTIONS_AND_STOP {  /* In case of invalid input */  \
     printf("To execute using LRU algorithm:\n./ergasia2 LRU <num_of_frames> <q> <max_num_of_references>\n\n");  \
+    printf("To execute using CLOCK, ARC, 2Q or OPT (Belady's optimal) algorithm:\n./ergasia2 <algorithm> <num_of_frames> <q> <max_num_of_references>\n\n");  \
     printf("To execute using WS algorithm:\n./ergasia2 WS <num_of_frames> <q> <ws_size> <max_num_of_references>\n\n");  \
-    printf("NOTE: It is optional to provide <max_num_of_references>\n");  \
+    printf("To simulate every combination of the given values (a CSV row each):\n./ergasia2 SWEEP <frames_list> <q_list> <ws_size_list> <max_num_of_references>\n");  \
+    printf("(a list is comma separated values and/or start:end:step ranges, e.g. 100,200:1000:200)\n\n");  \
+    printf("To get the LRU page faults for every number of frames at once (a CSV row each):\n./ergasia2 MRC <q> <max_num_of_references>\n\n");  \
+    printf("NOTE: It is optional to provide <max_num_of_references>\n\n");  \
+    printf("Options (may appear anywhere after ./ergasia2):\n");  \
+    printf("--trace=<file>          Add a process that replays this trace (repeat for more processes, default: bzip.trace and gcc.trace)\n");  \
+    printf("                        It may also be - (standard input), a named pipe, a .gz/.zst/.xz/.bz2 file or \"<command> |\"\n");  \
+    printf("--lru-scan              Select the LRU victim by scanning every timestamp (reference implementation)\n");  \
+    printf("--quiet                 Show only the results (no events)\n");  \
+    printf("--sample=<n>            Show the events of every n-th reference only\n");  \
+    printf("--events=<file>         Write every event to a machine-readable file aswell\n");  \
+    printf("--events-format=<fmt>   Format of that file: csv (default) or binary\n");  \
+    printf("--payload=<mode>        Contents of the frames: none (default, metadata only) or lazy (memory committed on first write)\n");  \
+    printf("--page-size=<size>      Size of a page in bytes, a power of 2 with an optional K, M or G suffix (default: 4K, up to 1G, e.g. 2M)\n");  \
+    printf("--address-bits=<n>      Width of the logical addresses of the traces, up to 64 (default: 32)\n");  \
+    printf("--checkpoint=<file>     Save the whole state of the simulation to this file once --checkpoint-at references are resolved\n");  \
+    printf("--checkpoint-at=<n>     The number of resolved references (in total) after which the checkpoint is saved\n");  \
+    printf("--resume=<file>         Continue from a checkpoint, with the same algorithm, frames, ws_size, page size, address width and traces\n");  \
+    printf("                        (max counts the references before the checkpoint too, q may change except for OPT)\n");  \
+    printf("--metrics=<file>        Write per-process metrics every --metrics-interval references (built only with make METRICS=1)\n");  \
+    printf("--metrics-format=<fmt>  Format of that file: csv (default) or json\n");  \
+    printf("--metrics-interval=<n>  The references per row of the metrics (default: 10000)\n");  \
+    printf("--metrics-perf          Also count the cycles of the timed hot paths (Linux perf_event)\n");  \
+    printf("--algorithms=<list>     SWEEP only: the algorithms to simulate, e.g. LRU,CLOCK,ARC,2Q,OPT,WS (default: LRU,WS)\n");  \
+    printf("--threads=<n>           SWEEP only: how many simulations run in parallel (default: one per processor)\n");  \
+    printf("--sweep-output=<file>   SWEEP only: write the rows to this file instead of the standard output\n");  \
     return ERROR;  \
 }
 
-typedef struct Frame_Type {
-    char data[FRAME_SIZE];  /* Frame consists of a defined number of bytes */
-} Frame;
+typedef struct Options_Type {  /* Settings given as "--name" or "--name=value" arguments */
+    const char **trace_paths;  /* The trace of each process, in round robin order */
+    int num_of_traces;
+    bool lru_scan;  /* Find the LRU victim by scanning the timestamps instead of taking the tail of the recency list */
+    Verbosity verbosity;
+    int sample_interval;  /* With VERBOSITY_SAMPLED, show the references whose overall number is a multiple of this */
+    const char *events_path;  /* Where to write the event stream (NULL for no stream) */
+    Event_Format events_format;
+    Payload payload;
+    uint64_t page_size;
+    int address_bits;
+    Address_Layout layout;  /* Derived once from page_size and address_bits */
+    const char *checkpoint_path;  /* Where to save the state of the simulation (NULL for no checkpoint) */
+    long long checkpoint_at;  /* After how many resolved references (in total) */
+    const char *resume_path;  /* The checkpoint to continue from (NULL to start from the beginning) */
+    const char *metrics_path;  /* Where to write the time series (NULL for none) */
+    bool metrics_json;  /* In JSON instead of CSV */
+    long long metrics_interval;  /* The references per row */
+    bool metrics_perf;  /* Count cycles through perf_event as well */
+    Algorithm *algorithms;  /* The algorithms of a sweep */
+    int num_of_algorithms;
+    int num_of_threads;  /* The workers of a sweep (0 for one per processor) */
+    const char *sweep_output_path;  /* Where to write the rows of a sweep (NULL for standard output) */
+} Options;
 
-typedef enum Process_ID {  /* ID to uniquely identify each process */
-    BZIP,
-    GCC
-} Process_ID;
-
-typedef struct IPT_Entry_Type {  /* Each entry of the Inverted Page Table corresponds to a frame of main memory */
-    Process_ID pid;  /* The ID of the process that currently uses this entry */
-    int page_num;  /* The identifier of the hosted page */
-    int timestamp;  /* Indicates the last time (virtual, not actual time) there was a reference to the hosted page */
-    bool modified;  /* Shows whether the hosted page has been written since the last time it got loaded from hard disk */
-    bool valid;  /* If this is true, the rest information of the entry is reliable. Else it is trash and the entry is actually empty */
-} IPT_Entry;
-
-typedef struct Reference_Type {  /* Request to perform an action to a specific data of a page */
-    int page_num;  /* The identifier of the page */
-    int offset;  /* Specify in which point of the page the desired data begins */
-    char action;  /* 'R' stands for READ and 'W' stands for WRITE (Anything else is invalid and will lead to error) */
-} Reference;
-
-double Logarithm(double x, int base) {  /* Calculate log(x) with given base */
-    return log(x) / log(base);  /* Change of base formula */
+uint64_t Parse_Size(const char *text) {  /* A number of bytes with an optional K, M or G suffix (0 if it is not one) */
+    char *suffix;
+    unsigned long long size = strtoull(text, &suffix, 10);
+    if (suffix == text)
+        return 0;  /* No digits */
+    int shift = 0;
+    if (*suffix == 'K')
+        shift = 10;
+    else if (*suffix == 'M')
+        shift = 20;
+    else if (*suffix == 'G')
+        shift = 30;
+    if (shift > 0)
+        suffix++;
+    if (*suffix != '\0' || size > (UINT64_MAX >> shift))
+        return 0;
+    return (uint64_t)size << shift;
 }
 
-int Bit_Size_To_Hex_Size(int num_of_bits) {  /* Find the minimum number of hex digits to represent the same numeric values as the given number of bits */
-    int hex_base = 16;
-    int bits_per_hex_digit = Logarithm(hex_base, 2);  /* Each hex digit can be broken down to 4 bits */
-    int num_of_hex_digits = ceil(num_of_bits / bits_per_hex_digit);  /* Round up if the number of bits is not multiple of 4 */
-    return num_of_hex_digits;
+const char *Option_Value(const char *argument, const char *name) {  /* If the argument is "<name>=<value>" return the value, else NULL */
+    size_t length = strlen(name);
+    if (strncmp(argument, name, length) == 0 && argument[length] == '=')
+        return argument + length + 1;
+    return NULL;
 }
 
-void Print_Not_Null_Terminated_String(char *str, int length) {  /* Used to print not null-terminated strings (relies on given length) */
-    for (int i = 0; i < length; i++) {
-        printf("%c", str[i]);  /* Print each character */
+int Parse_Options(int argc, char *argv[], Options *options) {  /* Extract the options from argv, keep the rest of the arguments in order and return their number (INVALID for unknown options) */
+    /* Default settings */
+    options->trace_paths = (const char **)malloc(argc * sizeof(const char *));  /* There cannot be more traces than arguments */
+    options->num_of_traces = 0;
+    options->lru_scan = FALSE;
+    options->verbosity = VERBOSITY_FULL;
+    options->sample_interval = 1;
+    options->events_path = NULL;
+    options->events_format = EVENT_CSV;
+    options->payload = PAYLOAD_NONE;
+    options->page_size = FRAME_SIZE;
+    options->address_bits = LOGICAL_ADDRESS_BITS;
+    options->checkpoint_path = NULL;
+    options->checkpoint_at = INVALID;
+    options->resume_path = NULL;
+    options->metrics_path = NULL;
+    options->metrics_json = FALSE;
+    options->metrics_interval = METRICS_DEFAULT_INTERVAL;
+    options->metrics_perf = FALSE;
+    options->algorithms = (Algorithm *)malloc(argc * sizeof(Algorithm) + 2 * sizeof(Algorithm));  /* Room for the defaults too */
+    options->num_of_algorithms = 0;
+    options->num_of_threads = 0;
+    options->sweep_output_path = NULL;
+    int kept = 1;  /* argv[0] is always kept */
+    const char *value;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--", 2) != 0)
+            argv[kept++] = argv[i];  /* Not an option */
+        else if ((value = Option_Value(argv[i], "--trace")) != NULL)
+            options->trace_paths[options->num_of_traces++] = value;
+        else if (strcmp(argv[i], "--lru-scan") == 0)
+            options->lru_scan = TRUE;
+        else if (strcmp(argv[i], "--quiet") == 0)
+            options->verbosity = VERBOSITY_SUMMARY;
+        else if ((value = Option_Value(argv[i], "--sample")) != NULL) {
+            options->verbosity = VERBOSITY_SAMPLED;
+            options->sample_interval = atoi(value);
+            if (options->sample_interval < 1)
+                return INVALID;
+        }
+        else if ((value = Option_Value(argv[i], "--events")) != NULL)
+            options->events_path = value;
+        else if ((value = Option_Value(argv[i], "--events-format")) != NULL) {
+            if (strcmp(value, "csv") == 0)
+                options->events_format = EVENT_CSV;
+            else if (strcmp(value, "binary") == 0)
+                options->events_format = EVENT_BINARY;
+            else
+                return INVALID;
+        }
+        else if ((value = Option_Value(argv[i], "--payload")) != NULL) {
+            if (strcmp(value, "none") == 0)
+                options->payload = PAYLOAD_NONE;
+            else if (strcmp(value, "lazy") == 0)
+                options->payload = PAYLOAD_LAZY;
+            else
+                return INVALID;
+        }
+        else if ((value = Option_Value(argv[i], "--page-size")) != NULL)
+            options->page_size = Parse_Size(value);  /* 0 is rejected along with the layout */
+        else if ((value = Option_Value(argv[i], "--address-bits")) != NULL)
+            options->address_bits = atoi(value);
+        else if ((value = Option_Value(argv[i], "--checkpoint")) != NULL)
+            options->checkpoint_path = value;
+        else if ((value = Option_Value(argv[i], "--checkpoint-at")) != NULL) {
+            options->checkpoint_at = atoll(value);
+            if (options->checkpoint_at < 1)
+                return INVALID;
+        }
+        else if ((value = Option_Value(argv[i], "--resume")) != NULL)
+            options->resume_path = value;
+        else if ((value = Option_Value(argv[i], "--metrics")) != NULL)
+            options->metrics_path = value;
+        else if ((value = Option_Value(argv[i], "--metrics-format")) != NULL) {
+            if (strcmp(value, "csv") == 0)
+                options->metrics_json = FALSE;
+            else if (strcmp(value, "json") == 0)
+                options->metrics_json = TRUE;
+            else
+                return INVALID;
+        }
+        else if ((value = Option_Value(argv[i], "--metrics-interval")) != NULL) {
+            options->metrics_interval = atoll(value);
+            if (options->metrics_interval < 1)
+                return INVALID;
+        }
+        else if (strcmp(argv[i], "--metrics-perf") == 0)
+            options->metrics_perf = TRUE;
+        else if ((value = Option_Value(argv[i], "--algorithms")) != NULL) {
+            char name[16];
+            while (*value != '\0') {  /* Comma separated names */
+                size_t length = strcspn(value, ",");
+                if (length >= sizeof(name))
+                    return INVALID;
+                memcpy(name, value, length);
+                name[length] = '\0';
+                int algorithm = Algorithm_From_Name(name);
+                if (algorithm == INVALID || options->num_of_algorithms == argc)
+                    return INVALID;
+                options->algorithms[options->num_of_algorithms++] = (Algorithm)algorithm;
+                value += (value[length] == ',') ? length + 1 : length;
+            }
+        }
+        else if ((value = Option_Value(argv[i], "--threads")) != NULL) {
+            options->num_of_threads = atoi(value);
+            if (options->num_of_threads < 1)
+                return INVALID;
+        }
+        else if ((value = Option_Value(argv[i], "--sweep-output")) != NULL)
+            options->sweep_output_path = value;
+        else
+            return INVALID;
     }
-    printf("\n");
-}
-
-Reference TranslateBuffer(char buffer[BUFFER_SIZE]) {  /* Extract information from the contents of the buffer */	
-    Reference reference;  /* A reference consists of page number, offset and action */
-    int page_num_hex_size = Bit_Size_To_Hex_Size(PAGE_NUM_BITS);  /* Convert to hex size, because we have the ASCII of hex digits */
-    char page_num_str[page_num_hex_size + 1];  /* It fits the hex representation of page number and '\0' */
-    memcpy(page_num_str, buffer, page_num_hex_size);  /* Copy the hex representation of page number from the buffer */
-    page_num_str[page_num_hex_size] = '\0';  /* Add '\0' at the end so it is an actual string */
-    reference.page_num = strtol(page_num_str, NULL, 16);  /* Convert string in hex to integer */
-    int offset_hex_size = Bit_Size_To_Hex_Size(OFFSET_BITS);  /* Convert to hex size, because we have the ASCII of hex digits */
-    char offset_str[offset_hex_size + 1];  /* It fits the hex representation of offset and '\0' */
-    memcpy(offset_str, (buffer + page_num_hex_size), offset_hex_size);  /* Copy the hex representation of offset from the buffer */
-    offset_str[offset_hex_size] = '\0';  /* Add '\0' at the end so it is an actual string */
-    reference.offset = strtol(offset_str, NULL, 16);  /* Convert string in hex to integer */
-    reference.action = buffer[BUFFER_SIZE - 1];  /* The last character of the buffer specifies the action (READ or WRITE) */
-    return reference;
-}
-
-void WS_Insert_Page(int *working_set, int ws_size, int page_num) {  /* Insert page to working set */
-    for (int i = 1; i < ws_size; i++) {
-        working_set[i - 1] = working_set[i];  /* Do the necessary shift to the already existing pages */
+    if (Address_Layout_Init(&options->layout, options->page_size, options->address_bits) != OK)  /* Every shift and mask is computed here, once */
+        return INVALID;
+    if ((options->checkpoint_path == NULL) != (options->checkpoint_at == INVALID))  /* One makes no sense without the other */
+        return INVALID;
+    if (options->num_of_algorithms == 0) {  /* A sweep covers both algorithms by default */
+        options->algorithms[options->num_of_algorithms++] = ALGORITHM_LRU;
+        options->algorithms[options->num_of_algorithms++] = ALGORITHM_WS;
+    }
+    if (options->num_of_traces == 0) {  /* The original pair of processes */
+        options->trace_paths[options->num_of_traces++] = "bzip.trace";
+        options->trace_paths[options->num_of_traces++] = "gcc.trace";
     }
-    working_set[ws_size - 1] = page_num;  /* Add the newcomer to the end of the working set */
+    return kept;
 }
 
-void WS_Remove_Page(int *working_set, int ws_size, int page_num) {  /* Remove page from working set */
-    for (int i = 0; i < ws_size; i++) {
-        if (working_set[i] == page_num) {  /* If the specified page is found */
-            working_set[i] = INVALID;  /* Release its slot */
-            break;
-        }
+int Sweep(int argc, char *argv[], Options *options) {  /* SWEEP mode: simulate every combination of the given values */
+    if (argc < 5 || argc > 6)
+        GIVE_INSTRUCTIONS_AND_STOP;
+    Sweep_Spec spec;
+    spec.algorithms = options->algorithms;
+    spec.num_of_algorithms = options->num_of_algorithms;
+    spec.max_num_of_references = (argc == 6) ? atoll(argv[5]) : INVALID;
+    spec.layout = options->layout;
+    spec.trace_paths = options->trace_paths;
+    spec.num_of_processes = options->num_of_traces;
+    spec.num_of_threads = options->num_of_threads;
+    spec.output_path = options->sweep_output_path;
+    spec.frames = spec.q_values = spec.ws_sizes = NULL;
+    int status = OK;
+    if (Sweep_Parse_List(argv[2], &spec.frames, &spec.num_of_frames_values) != OK || Sweep_Parse_List(argv[3], &spec.q_values, &spec.num_of_q_values) != OK || Sweep_Parse_List(argv[4], &spec.ws_sizes, &spec.num_of_ws_sizes) != OK)
+        status = INVALID;
+    for (int i = 0; status == OK && i < spec.num_of_frames_values; i++) {
+        if (spec.frames[i] < 1)
+            status = INVALID;
+    }
+    for (int i = 0; status == OK && i < spec.num_of_q_values; i++) {
+        if (spec.q_values[i] < 1)
+            status = INVALID;
     }
+    for (int i = 0; status == OK && i < spec.num_of_ws_sizes; i++) {
+        if (spec.ws_sizes[i] < 1)
+            status = INVALID;
+    }
+    if (status == OK)
+        status = Sweep_Run(&spec);
+    free(spec.frames);
+    free(spec.q_values);
+    free(spec.ws_sizes);
+    if (status == INVALID)
+        GIVE_INSTRUCTIONS_AND_STOP;
+    return status;
 }
 
-bool WS_Includes_This_Page(int *working_set, int ws_size, int page_num) {  /* Check whether the working set includes this page or not */
-    for (int i = 0; i < ws_size; i++) {
-        if (working_set[i] == page_num)
-            return TRUE;  /* The specified page is found */
-    }
-    return FALSE;
+int Miss_Ratio_Curve(int argc, char *argv[], Options *options) {  /* MRC mode: the LRU page faults of every number of frames from a single pass */
+    if (argc < 3 || argc > 4)
+        GIVE_INSTRUCTIONS_AND_STOP;
+    MRC_Spec spec;
+    spec.q = atoi(argv[2]);
+    spec.max_num_of_references = (argc == 4) ? atoll(argv[3]) : INVALID;
+    spec.layout = options->layout;
+    spec.trace_paths = options->trace_paths;
+    spec.num_of_processes = options->num_of_traces;
+    spec.output = stdout;
+    if (spec.q < 1)
+        GIVE_INSTRUCTIONS_AND_STOP;
+    return MRC_Run(&spec);
 }
 
 int main(int argc, char *argv[]) {
-    if (argc < 4 || argc > 6 || (argc > 1 && strcmp(argv[1], "LRU") != 0 && strcmp(argv[1], "WS") != 0))  /* Invalid number of arguments or invalid algorithm */
+    Options options;
+    argc = Parse_Options(argc, argv, &options);  /* From now on only the positional arguments are left in argv */
+    if (argc > 1 && (strcmp(argv[1], "SWEEP") == 0 || strcmp(argv[1], "MRC") == 0)) {  /* Modes that write CSV rows instead of a simulation */
+        static char rows_output_buffer[OUTPUT_BUFFER_SIZE];
+        setvbuf(stdout, rows_output_buffer, _IOFBF, OUTPUT_BUFFER_SIZE);
+        int status = (strcmp(argv[1], "SWEEP") == 0) ? Sweep(argc, argv, &options) : Miss_Ratio_Curve(argc, argv, &options);
+        free(options.trace_paths);
+        free(options.algorithms);
+        return status;
+    }
+    int algorithm = (argc > 1) ? Algorithm_From_Name(argv[1]) : INVALID;  /* Resolve the algorithm's name once */
+    if (argc < 4 || argc > 6 || algorithm == INVALID)  /* Invalid number of arguments or invalid algorithm */
         GIVE_INSTRUCTIONS_AND_STOP;
     
-    char algorithm[4];  /* Enough characters to save LRU and '\0' (or WS and '\0') */
-    strcpy(algorithm, argv[1]);  /* The algorithm's name as a string */
-    int num_of_frames = atoi(argv[2]);  /* The number of available frames in main memory */
-    int q = atoi(argv[3]);  /* After q resolved references in one file continue to the other one */
+    Simulator_Config config;
+    config.algorithm = (Algorithm)algorithm;
+    config.lru_scan = options.lru_scan;
+    config.num_of_frames = atoi(argv[2]);  /* The number of available frames in main memory */
+    config.q = atoi(argv[3]);  /* After q resolved references of one process continue to the next one */
+    config.ws_size = INVALID;  /* This determines how many pages each working set can carry simultaneously */
+    config.max_num_of_references = INVALID;  /* After resolving this number of references (in total) the simulation ends */
+    config.layout = options.layout;  /* Computed once */
+    config.trace_paths = options.trace_paths;
+    config.num_of_processes = options.num_of_traces;
+    config.verbosity = options.verbosity;
+    config.sample_interval = options.sample_interval;
+    config.events = NULL;
+    config.payload = options.payload;
+    config.preloaded = NULL;  /* Each trace is read while the simulation goes on */
+    
+    static char output_buffer[OUTPUT_BUFFER_SIZE];
+    setvbuf(stdout, output_buffer, _IOFBF, OUTPUT_BUFFER_SIZE);  /* One write per block instead of one per line */
+    bool show_specifications = (options.verbosity != VERBOSITY_SUMMARY);
     
-    printf("\nSpecifications:\n");
-    printf("Algorithm: %s\n", algorithm);
-    printf("Number of frames: %d\n", num_of_frames);
-    printf("Number q: %d\n", q);
+    if (show_specifications) {
+        printf("\nSpecifications:\n");
+        printf("Algorithm: %s\n", argv[1]);
+        printf("Number of frames: %d\n", config.num_of_frames);
+        printf("Number q: %d\n", config.q);
+    }
     
-    int ws_size = INVALID;  /* This determines how many pages each working set can carry simultaneously */
-    int max_num_of_references = INVALID;  /* After resolving this number of references (in total) the simulation ends */
-    if (strcmp(algorithm, "LRU") == 0) {
+    if (!Algorithm_Uses_Working_Sets(config.algorithm)) {
         if (argc == 5) {  /* User provided max_num_of_references (it is optional) */
-            max_num_of_references = atoi(argv[4]);
-            printf("Max number of references: %d\n", max_num_of_references);
+            config.max_num_of_references = atoll(argv[4]);
+            if (show_specifications)
+                printf("Max number of references: %lld\n", config.max_num_of_references);
         }
-        else if (argc == 6)  /* Too many arguments for LRU */
+        else if (argc == 6)  /* Too many arguments without a working set */
             GIVE_INSTRUCTIONS_AND_STOP;
+        if (config.algorithm == ALGORITHM_LRU && options.lru_scan && show_specifications)
+            printf("LRU victim selection: timestamp scan\n");
     }
-    else if (strcmp(algorithm, "WS") == 0) {
+    else {
         if (argc < 5)  /* Too few arguments for WS */
             GIVE_INSTRUCTIONS_AND_STOP;
-        ws_size = atoi(argv[4]);
-        printf("Working set size: %d\n", ws_size);
+        config.ws_size = atoi(argv[4]);
+        if (show_specifications)
+            printf("Working set size: %d\n", config.ws_size);
         if (argc == 6) {  /* User provided max_num_of_references (it is optional) */
-            max_num_of_references = atoi(argv[5]);
-            printf("Max number of references: %d\n", max_num_of_references);
+            config.max_num_of_references = atoll(argv[5]);
+            if (show_specifications)
+                printf("Max number of references: %lld\n", config.max_num_of_references);
         }
     }
+    if (config.num_of_frames < 1 || config.q < 1 || (Algorithm_Uses_Working_Sets(config.algorithm) && config.ws_size < 1))
+        GIVE_INSTRUCTIONS_AND_STOP;
+    if (show_specifications && options.num_of_traces != DEFAULT_NUM_OF_FILES)
+        printf("Number of processes: %d\n", options.num_of_traces);
+    if (show_specifications && options.payload == PAYLOAD_LAZY)
+        printf("Payload: lazy\n");
+    if (show_specifications && options.page_size != FRAME_SIZE)
+        printf("Page size: %llu bytes\n", (unsigned long long)options.page_size);
+    if (show_specifications && options.address_bits != LOGICAL_ADDRESS_BITS)
+        printf("Logical address bits: %d\n", options.address_bits);
+    if (show_specifications && options.resume_path != NULL)
+        printf("Resumed from: %s\n", options.resume_path);
+    if (show_specifications && options.checkpoint_path != NULL)
+        printf("Checkpoint: %s after %lld references\n", options.checkpoint_path, options.checkpoint_at);
     
-    /* Allocate space to simulate the main memory */
-    Frame *main_memory;
-    main_memory = (Frame *)malloc(num_of_frames * sizeof(Frame));
-    if (main_memory == NULL) {
-        printf("An error occured during memory allocation\n");
-        return ERROR;
-    }
-    
-    /* Allocate space for the Inverted Page Table (IPT) */
-    IPT_Entry *IPT;
-    IPT = (IPT_Entry *)malloc(num_of_frames * sizeof(IPT_Entry));
-    if (IPT == NULL) {
-        printf("An error occured during memory allocation\n");
+#ifndef ENABLE_METRICS
+    if (options.metrics_path != NULL) {
+        printf("Metrics are not built in (build with make -B METRICS=1)\n");
         return ERROR;
     }
+#endif
     
-    /* Initialize the IPT's entries */
-    for (int frame = 0; frame < num_of_frames; frame++) {
-        IPT[frame].valid = FALSE;  /* Initialy the information in the entries is invalid (trash) */
-    }
-    
-    int *ws_bzip, *ws_gcc;  /* Each process has its own working set */
-    if (strcmp(algorithm, "WS") == 0) {
-        /* Allocate space for each working set */
-        ws_bzip = (int *)malloc(ws_size * sizeof(int));
-        if (ws_bzip == NULL) {
-            printf("An error occured during memory allocation\n");
+    if (options.events_path != NULL) {  /* The machine-readable event stream was requested */
+        config.events = Event_Log_Open(options.events_path, options.events_format);
+        if (config.events == NULL) {
+            printf("Could not create file %s\n", options.events_path);
             return ERROR;
         }
-        ws_gcc = (int *)malloc(ws_size * sizeof(int));
-        if (ws_gcc == NULL) {
-            printf("An error occured during memory allocation\n");
-            return ERROR;
-        }
-        /* Initialize the working sets */
-        for (int i = 0; i < ws_size; i++) {
-            ws_bzip[i] = INVALID;  /* Initially each slot contains trash (not a valid page number) */
-            ws_gcc[i] = INVALID;  /* The same applies here aswell */
-        }
     }
     
-    printf("\nSimulation:\n");
-    int reference_count = 0;  /* Count the currently resolved references (both files included) */
-    int load_count = 0;  /* Count how many times it was necessary to load page from hard disk to main memory (both files included) */
-    int save_count = 0;  /* Count how many times it was necessary to save page from main memory to hard disk (both files included) */
-    int pf_bzip = 0;  /* Count how many references of bzip led to page fault */
-    int pf_gcc = 0;  /* Count how many references of gcc led to page fault */
-    int references_bzip = 0;  /* Count how many references of bzip have been resolved so far */
-    int references_gcc = 0;  /* Count how many references of gcc have been resolved so far */
-    FILE *bzip, *gcc;
-    bzip = fopen("bzip.trace", "r");  /* Open bzip file */
-    gcc = fopen("gcc.trace", "r");  /* Open gcc file */
-    char buffer[BUFFER_SIZE];  /* Buffer to store the current reference */
-    for (int file = 0; ; file++) {  /* An integer that increases in order to repeatedly switch between these two files (using modulo) */
-        switch (file % NUM_OF_FILES) {  /* This determines whose turn is to continue resolving references */
-            case BZIP:  /* Half of the times it is bzip's turn */
-                if (feof(bzip))  /* If there are no more bzip references to resolve, stop this case */
-                    break;
-                for (int ref = 0; ref < q; ref++) {  /* Resolve q references of bzip */
-                    references_bzip++;  /* Resolving one more reference of bzip */
-                    reference_count++;  /* Therefore resolving one more reference overall */
-                    printf("Reference %d of bzip (%d overall): ", references_bzip, reference_count);
-                    fread(buffer, sizeof(buffer), 1, bzip);  /* Read from file as much as you need to know about this reference */
-                    Print_Not_Null_Terminated_String(buffer, BUFFER_SIZE);  /* buffer doesn't contain a proper string so %s identifier would cause undefined behavior */
-                    Reference reference = TranslateBuffer(buffer);  /* Turn the information stored in buffer to an actual reference */
-                    int frame_pos = INVALID;  /* This will show which frame hosts the requested page */
-                    for (int frame = 0; frame < num_of_frames; frame++) {  /* Scan the contents of each frame (via the corresponding IPT's entry) */
-                        if (IPT[frame].valid == TRUE && IPT[frame].pid == BZIP && IPT[frame].page_num == reference.page_num) {  /* The requested page is already loaded (best case scenario) */
-                            frame_pos = frame;  /* Save the position of the frame that hosts the requested page */
-                            break;
-                        }
-                    }
-                    if (frame_pos == INVALID) {  /* The requested page was not found in any frame, so we need to find a frame to load it */
-                        pf_bzip++;  /* That means a page fault occured due to this reference of bzip */
-                        for (int frame = 0; frame < num_of_frames; frame++) {  /* Scan the contents of each frame (via the corresponding IPT's entry) */
-                            if (IPT[frame].valid == FALSE) {  /* If an empty frame was found, load the page here */
-                                printf("LOAD page %d from hard disk to frame %d of main memory\n", reference.page_num, frame);
-                                load_count++;  /* Increase by 1 the number of loads */
-                                /* Update the corresponding IPT's entry */
-                                IPT[frame].pid = BZIP;
-                                IPT[frame].page_num = reference.page_num;
-                                IPT[frame].modified = FALSE;
-                                IPT[frame].valid = TRUE;
-                                frame_pos = frame;  /* Save the position of the frame that hosts the requested page */
-                                break;
-                            }
-                        }
-                    }
-                    if (frame_pos == INVALID) {  /* There wasn't any available frame (main memory is full) so page replacement required */
-                        if (strcmp(algorithm, "LRU") == 0) {
-                            int frame_with_min_timestamp = 0;  /* This will show the frame that hosts the page with the min timestamp */
-                            for (int frame = 0; frame < num_of_frames; frame++) {  /* Scan the contents of each frame (via the corresponding IPT's entry) */
-                                if (IPT[frame].timestamp < IPT[frame_with_min_timestamp].timestamp)  /* If the frame hosts a page with timestamp less than the min so far */
-                                    frame_with_min_timestamp = frame;  /* Save its position */
-                            }
-                            frame_pos = frame_with_min_timestamp;  /* Save the position of the frame that will host the requested page */
-                        }
-                        else if (strcmp(algorithm, "WS") == 0) {
-                            for (int frame = 0; frame < num_of_frames; frame++) {  /* Scan the contents of each frame (via the corresponding IPT's entry) */
-                                if ((IPT[frame].pid == BZIP && !WS_Includes_This_Page(ws_bzip, ws_size, IPT[frame].page_num)) ||
-                                        (IPT[frame].pid == GCC && !WS_Includes_This_Page(ws_gcc, ws_size, IPT[frame].page_num))) {  /* If none of the working sets doesn't include the hosted page of a frame */
-                                    frame_pos = frame;  /* This page will be replaced by the requested one, so save the position of this frame */
-                                    break;
-                                }
-                            }
-                            if (frame_pos == INVALID) {  /* If there was not such a page that doesn't belongs to neither of the working sets, disturb gcc's woking set */
-                                printf("NOTE: Due to memory restriction bzip had to disturb gcc's working set in order to keep running\n");
-                                for (int frame = 0; frame < num_of_frames; frame++) {  /* Scan the contents of each frame (via the corresponding IPT's entry) */
-                                    if (IPT[frame].pid == GCC) {  /* If the hosted page belongs to gcc */
-                                        WS_Remove_Page(ws_gcc, ws_size, IPT[frame].page_num);  /* Remove this page from gcc's working set */
-                                        frame_pos = frame;  /* This page will be replaced by the requested one, so save the position of this frame */
-                                        break;
-                                    }
-                                }
-                            }
-                            if (frame_pos == INVALID) {  /* If even that didn't solve the problem, the frames are too few to support working sets of this size */
-                                printf("ERROR: Given working set size (%d) cannot be satisfied by %d frames\n", ws_size, num_of_frames);
-                                return ERROR;
-                            }
-                        }
-                        if (IPT[frame_pos].modified == TRUE) {  /* If the page that is going to be replaced has been modified, save it to hard disk */
-                            printf("SAVE page %d from frame %d of main memory to hard disk\n", IPT[frame_pos].page_num, frame_pos);
-                            save_count++;  /* Increase by 1 the number of saves */
-                        }
-                        printf("LOAD page %d from hard disk to frame %d of main memory\n", reference.page_num, frame_pos);
-                        load_count++;  /* Increase by 1 the number of loads */
-                        /* Update the corresponding IPT's entry */
-                        IPT[frame_pos].pid = BZIP;
-                        IPT[frame_pos].page_num = reference.page_num;
-                        IPT[frame_pos].modified = FALSE;
-                    }
-                    IPT[frame_pos].timestamp = reference_count;  /* Using reference_count so the timestamps of two consecutive references differ by 1 */
-                    Frame *target_frame = main_memory + frame_pos;  /* The frame that hosts the requested page */
-                    char *target_data = ((char *)target_frame) + reference.offset;  /* The specified data to perform the action (READ or WRITE) */
-                    switch(reference.action) {
-                        case 'R':  /* "Read" */
-                            printf("READ page %d from frame %d of main memory\n", reference.page_num, frame_pos);
-                            break;
-                        case 'W':  /* "Write" */
-                            printf("WRITE page %d to frame %d of main memory\n", reference.page_num, frame_pos);
-                            IPT[frame_pos].modified = TRUE;  /* The page has been "written" */
-                            break;
-                        default:
-                            printf("Invalid reference detected in file bzip\n");
-                            return ERROR;
-                    }
-                    if (strcmp(algorithm, "WS") == 0) {
-                        WS_Insert_Page(ws_bzip, ws_size, reference.page_num);  /* Add this page to the working set of bzip */
-                    }
-                    if ((max_num_of_references != INVALID && reference_count == max_num_of_references) || feof(bzip))
-                        break;  /* Stop this loop if the number of references reached the max or there are no more bzip references to resolve */
-                    fgetc(bzip);  /* Skip end of line that follows 'R' or 'W' */
-                }
-                break;
-                
-            case GCC:  /* The other half of the times it is gcc's turn */
-                if (feof(gcc))  /* If there are no more gcc references to resolve, stop this case */
-                    break;
-                for (int ref = 0; ref < q; ref++) {  /* Resolve q references of gcc */
-                    references_gcc++;  /* Resolving one more reference of gcc */
-                    reference_count++;  /* Therefore resolving one more reference overall */
-                    printf("Reference %d of gcc (%d overall): ", references_gcc, reference_count);
-                    fread(buffer, sizeof(buffer), 1, gcc);  /* Read from file as much as you need to know about this reference */
-                    Print_Not_Null_Terminated_String(buffer, BUFFER_SIZE);  /* buffer doesn't contain a proper string so %s identifier would cause undefined behavior */
-                    Reference reference = TranslateBuffer(buffer);  /* Turn the information stored in buffer to an actual reference */
-                    int frame_pos = INVALID;  /* This will show which frame hosts the requested page */
-                    for (int frame = 0; frame < num_of_frames; frame++) {  /* Scan the contents of each frame (via the corresponding IPT's entry) */
-                        if (IPT[frame].valid == TRUE && IPT[frame].pid == GCC && IPT[frame].page_num == reference.page_num) {  /* The requested page is already loaded (best case scenario) */
-                            frame_pos = frame;  /* Save the position of the frame that hosts the requested page */
-                            break;
-                        }
-                    }
-                    if (frame_pos == INVALID) {  /* The requested page was not found in any frame, so we need to find a frame to load it */
-                        pf_gcc++;  /* That means a page fault occured due to this reference of gcc */
-                        for (int frame = 0; frame < num_of_frames; frame++) {  /* Scan the contents of each frame (via the corresponding IPT's entry) */
-                            if (IPT[frame].valid == FALSE) {  /* If an empty frame was found, load the page here */
-                                printf("LOAD page %d from hard disk to frame %d of main memory\n", reference.page_num, frame);
-                                load_count++;  /* Increase by 1 the number of loads */
-                                /* Update the corresponding IPT's entry */
-                                IPT[frame].pid = GCC;
-                                IPT[frame].page_num = reference.page_num;
-                                IPT[frame].modified = FALSE;
-                                IPT[frame].valid = TRUE;
-                                frame_pos = frame;  /* Save the position of the frame that hosts the requested page */
-                                break;
-                            }
-                        }
-                    }
-                    if (frame_pos == INVALID) {  /* There wasn't any available frame (main memory is full) so page replacement required */
-                        if (strcmp(algorithm, "LRU") == 0) {
-                            int frame_with_min_timestamp = 0;  /* This will show the frame that hosts the page with the min timestamp */
-                            for (int frame = 0; frame < num_of_frames; frame++) {  /* Scan the contents of each frame (via the corresponding IPT's entry) */
-                                if (IPT[frame].timestamp < IPT[frame_with_min_timestamp].timestamp)  /* If the frame hosts a page with timestamp less than the min so far */
-                                    frame_with_min_timestamp = frame;  /* Save its position */
-                            }
-                            frame_pos = frame_with_min_timestamp;  /* Save the position of the frame that will host the requested page */
-                        }
-                        else if (strcmp(algorithm, "WS") == 0) {
-                            for (int frame = 0; frame < num_of_frames; frame++) {  /* Scan the contents of each frame (via the corresponding IPT's entry) */
-                                if ((IPT[frame].pid == GCC && !WS_Includes_This_Page(ws_gcc, ws_size, IPT[frame].page_num)) ||
-                                        (IPT[frame].pid == BZIP && !WS_Includes_This_Page(ws_bzip, ws_size, IPT[frame].page_num))) {  /* If none of the working sets doesn't include the hosted page of a frame */
-                                    frame_pos = frame;  /* This page will be replaced by the requested one, so save the position of this frame */
-                                    break;
-                                }
-                            }
-                            if (frame_pos == INVALID) {  /* If there was not such a page that doesn't belongs to neither of the working sets, disturb bzip's woking set */
-                                printf("NOTE: Due to memory restriction gcc had to disturb bzip's working set in order to keep running\n");
-                                for (int frame = 0; frame < num_of_frames; frame++) {  /* Scan the contents of each frame (via the corresponding IPT's entry) */
-                                    if (IPT[frame].pid == BZIP) {  /* If the hosted page belongs to bzip */
-                                        WS_Remove_Page(ws_bzip, ws_size, IPT[frame].page_num);  /* Remove this page from bzip's working set */
-                                        frame_pos = frame;  /* This page will be replaced by the requested one, so save the position of this frame */
-                                        break;
-                                    }
-                                }
-                            }
-                            if (frame_pos == INVALID) {  /* If even that didn't solve the problem, the frames are too few to support working sets of this size */
-                                printf("ERROR: Given working set size (%d) cannot be satisfied by %d frames\n", ws_size, num_of_frames);
-                                return ERROR;
-                            }
-                        }
-                        if (IPT[frame_pos].modified == TRUE) {  /* If the page that is going to be replaced has been modified, save it to hard disk */
-                            printf("SAVE page %d from frame %d of main memory to hard disk\n", IPT[frame_pos].page_num, frame_pos);
-                            save_count++;  /* Increase by 1 the number of saves */
-                        }
-                        printf("LOAD page %d from hard disk to frame %d of main memory\n", reference.page_num, frame_pos);
-                        load_count++;  /* Increase by 1 the number of loads */
-                        /* Update the corresponding IPT's entry */
-                        IPT[frame_pos].pid = GCC;
-                        IPT[frame_pos].page_num = reference.page_num;
-                        IPT[frame_pos].modified = FALSE;
-                    }
-                    IPT[frame_pos].timestamp = reference_count;  /* Using reference_count so the timestamps of two consecutive references differ by 1 */
-                    Frame *target_frame = main_memory + frame_pos;  /* The frame that hosts the requested page */
-                    char *target_data = ((char *)target_frame) + reference.offset;  /* The specified data to perform the action (READ or WRITE) */
-                    switch(reference.action) {
-                        case 'R':  /* "Read" */
-                            printf("READ page %d from frame %d of main memory\n", reference.page_num, frame_pos);
-                            break;
-                        case 'W':  /* "Write" */
-                            printf("WRITE page %d to frame %d of main memory\n", reference.page_num, frame_pos);
-                            IPT[frame_pos].modified = TRUE;  /* The page has been "written" */
-                            break;
-                        default:
-                            printf("Invalid reference detected in file gcc\n");
-                            return ERROR;
-                    }
-                    if (strcmp(algorithm, "WS") == 0) {
-                        WS_Insert_Page(ws_gcc, ws_size, reference.page_num);  /* Add this page to the working set of gcc */
-                    }
-                    if ((max_num_of_references != INVALID && reference_count == max_num_of_references) || feof(gcc))
-                        break;  /* Stop this loop if the number of references reached the max or there are no more gcc references to resolve */
-                    fgetc(gcc);  /* Skip end of line that follows 'R' or 'W' */
-                }
-                break;
+    Simulator sim;
+    int status = Simulator_Create(&sim, &config);
+    if (status == OK && options.resume_path != NULL)
+        status = Checkpoint_Load(&sim, options.resume_path);  /* Every process continues where the checkpoint left it */
+#ifdef ENABLE_METRICS
+    if (status == OK && options.metrics_path != NULL) {
+        sim.metrics = Metrics_Open(options.metrics_path, options.metrics_json ? METRICS_JSON : METRICS_CSV, options.metrics_interval, sim.num_of_processes, options.metrics_perf);
+        if (sim.metrics == NULL)
+            status = Simulator_Fail(&sim, "Could not create file %s", options.metrics_path);
+        else
+            sim.metrics->last_row = sim.reference_count;  /* A resumed simulation starts its first interval at the checkpoint */
+    }
+#endif
+    bool checkpointed = FALSE;
+    if (status == OK) {
+        if (show_specifications)
+            printf("\nSimulation:\n");
+        if (options.checkpoint_path != NULL) {
+            status = Simulator_Run_Until(&sim, options.checkpoint_at);
+            if (status == OK && sim.reference_count == options.checkpoint_at) {  /* Not if the traces (or the max) ended earlier, or the resumed state is already past it */
+                status = Checkpoint_Save(&sim, options.checkpoint_path);
+                checkpointed = TRUE;
+            }
         }
-        if ((max_num_of_references != INVALID && reference_count == max_num_of_references) || (feof(bzip) && feof(gcc)))
-            break;
+        if (status == OK)
+            status = Simulator_Run(&sim);  /* The rest of the simulation, as if it never stopped */
     }
-    
-    fclose(bzip);  /* Close bzip file */
-    fclose(gcc);  /* Close gcc file */
-    
-    int used_frames = 0;  /* The number of frames that hosted atleast one page during this simulation */
-    for (int frame = 0; frame < num_of_frames; frame++) {  /* Scan the contents of each frame (via the corresponding IPT's entry) */
-        if (IPT[frame].valid == TRUE)  /* If the frame contains valid information */
-            used_frames++;  /* It has been used at some point */
+    if (status == OK)
+        Simulator_Print_Results(&sim);
+    else
+        printf("%s\n", sim.error);
+    if (status == OK && options.checkpoint_path != NULL && !checkpointed) {
+        printf("Checkpoint %s was not saved: the simulation never stopped after %lld resolved references\n", options.checkpoint_path, options.checkpoint_at);
+        status = ERROR;
     }
-    
-    /* Release the allocated memory */
-    if (strcmp(algorithm, "WS") == 0) {
-        free(ws_bzip);
-        free(ws_gcc);
+#ifdef ENABLE_METRICS
+    if (sim.metrics != NULL && Metrics_Close(sim.metrics, &sim) != OK) {
+        printf("Could not write file %s\n", options.metrics_path);
+        status = ERROR;
     }
-    free(IPT);
-    free(main_memory);
-    
-    printf("\nResults:\n");
-    printf("LOAD from hard disk to main memory (aka read from HD): %d pages\n", load_count);
-    printf("SAVE from main memory to hard disk (aka write to HD): %d pages\n", save_count);
-    printf("bzip: %d page faults, %d resolved references\n", pf_bzip, references_bzip);
-    printf("gcc: %d page faults, %d resolved references\n", pf_gcc, references_gcc);
-    printf("During this simulation: %d frames were used of %d available frames\n\n", used_frames, num_of_frames);
-    return OK;  /* Success */
+#endif
+    Simulator_Destroy(&sim);
+    if (config.events != NULL && Event_Log_Close(config.events) != OK)
+        printf("Could not write file %s\n", options.events_path);
+    free(options.trace_paths);
+    free(options.algorithms);
+    return status;
 }
@@ -0,0 +1,15 @@
+#ifndef ERGASIA2_H
+#define ERGASIA2_H
+
+/* Definitions shared by every module of the simulator */
+
+#define FRAME_SIZE 4096  /* The default page size (--page-size changes it) */
+#define LOGICAL_ADDRESS_BITS 32  /* The default width of a logical address (--address-bits changes it) */
+#define MAX_NUM_OF_FRAMES (1 << 30)  /* The most frames (and the largest working set) a simulation takes, so every power of 2 that sizes a table fits in an int */
+#define OK 0
+#define ERROR !OK
+#define INVALID -1
+#define FALSE 0
+#define TRUE !FALSE
+
+#endif
@@ -0,0 +1,103 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ergasia2.h"
+#include "events.h"
+
+static const char *event_names[] = {"LOAD", "SAVE", "READ", "WRITE", "DISTURB"};  /* Indexed by Event_Type */
+
+Event_Log *Event_Log_Open(const char *path, Event_Format format) {  /* Create the file of an event stream (NULL on error) */
+    Event_Log *log = (Event_Log *)malloc(sizeof(Event_Log));
+    if (log == NULL)
+        return NULL;
+    log->format = format;
+    log->length = 0;
+    log->buffer = (char *)malloc(EVENT_BUFFER_SIZE);
+    log->file = fopen(path, "wb");
+    if (log->buffer == NULL || log->file == NULL) {
+        if (log->file != NULL)
+            fclose(log->file);
+        free(log->buffer);
+        free(log);
+        return NULL;
+    }
+    setvbuf(log->file, NULL, _IONBF, 0);  /* The buffer of the log is enough */
+    if (format == EVENT_CSV) {
+        const char *header = "reference,process,event,page,frame\n";
+        memcpy(log->buffer, header, strlen(header));
+        log->length = strlen(header);
+    }
+    else {
+        unsigned char *header = (unsigned char *)log->buffer;
+        memcpy(header, EVENT_MAGIC, 8);
+        for (int i = 0; i < 4; i++) {
+            header[8 + i] = (EVENT_VERSION >> (8 * i)) & 0xFF;
+            header[12 + i] = (EVENT_RECORD_SIZE >> (8 * i)) & 0xFF;
+        }
+        log->length = 16;
+    }
+    return log;
+}
+
+void Event_Log_Flush(Event_Log *log) {  /* Write the buffered events to the file */
+    fwrite(log->buffer, 1, log->length, log->file);
+    log->length = 0;
+}
+
+int Event_Log_Close(Event_Log *log) {  /* Write what is left in the buffer and release the stream (OK or ERROR) */
+    Event_Log_Flush(log);
+    int status = ferror(log->file) ? ERROR : OK;
+    if (fclose(log->file) != 0)  /* Closed even after a write error */
+        status = ERROR;
+    free(log->buffer);
+    free(log);
+    return status;
+}
+
+static char *Append_Number(char *out, uint64_t value) {  /* Write the decimal digits of value and return where they end */
+    char digits[20];
+    int length = 0;
+    do {
+        digits[length++] = '0' + value % 10;
+        value /= 10;
+    } while (value > 0);
+    while (length > 0)
+        *out++ = digits[--length];  /* The digits were produced from the least significant one */
+    return out;
+}
+
+void Event_Log_Write(Event_Log *log, uint64_t reference, int process, Event_Type event, uint64_t page, int frame) {  /* Add an event to the stream */
+    if (log->length > EVENT_BUFFER_SIZE - 128)  /* Make sure the longest possible event fits */
+        Event_Log_Flush(log);
+    if (log->format == EVENT_CSV) {
+        char *out = log->buffer + log->length;
+        out = Append_Number(out, reference);
+        *out++ = ',';
+        out = Append_Number(out, process);
+        *out++ = ',';
+        size_t name_length = strlen(event_names[event]);
+        memcpy(out, event_names[event], name_length);
+        out += name_length;
+        *out++ = ',';
+        out = Append_Number(out, page);
+        *out++ = ',';
+        out = Append_Number(out, frame);
+        *out++ = '\n';
+        log->length = out - log->buffer;
+    }
+    else {
+        unsigned char *record = (unsigned char *)log->buffer + log->length;
+        for (int i = 0; i < 8; i++) {
+            record[i] = (reference >> (8 * i)) & 0xFF;
+            record[8 + i] = (page >> (8 * i)) & 0xFF;
+        }
+        for (int i = 0; i < 4; i++) {
+            record[16 + i] = ((uint32_t)frame >> (8 * i)) & 0xFF;
+        }
+        record[20] = process & 0xFF;
+        record[21] = (process >> 8) & 0xFF;
+        record[22] = event;
+        record[23] = 0;
+        log->length += EVENT_RECORD_SIZE;
+    }
+}
@@ -0,0 +1,44 @@
+#ifndef EVENTS_H
+#define EVENTS_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+/* Machine-readable log of what happens during the simulation. Events are packed into a large buffer
+   (without printf) and written in big blocks, so keeping the per-reference log costs little.
+
+   CSV:    a header line and then "reference,process,event,page,frame" per event
+   binary: a 16-byte header (magic "IPTEVENT", u32 version, u32 record size) and then EVENT_RECORD_SIZE
+           bytes per event, all little-endian: u64 reference, u64 page, u32 frame, u16 process, u8 event, u8 zero */
+
+#define EVENT_BUFFER_SIZE (1 << 20)
+#define EVENT_MAGIC "IPTEVENT"
+#define EVENT_VERSION 1
+#define EVENT_RECORD_SIZE 24
+
+typedef enum Event_Type {  /* What happened to a page */
+    EVENT_LOAD,  /* Loaded from hard disk to a frame */
+    EVENT_SAVE,  /* Saved from a frame to hard disk, because it was modified and got replaced */
+    EVENT_READ,
+    EVENT_WRITE,
+    EVENT_DISTURB  /* Replaced while still in the working set of its process */
+} Event_Type;
+
+typedef enum Event_Format {
+    EVENT_CSV,
+    EVENT_BINARY
+} Event_Format;
+
+typedef struct Event_Log_Type {  /* An open event stream */
+    FILE *file;
+    Event_Format format;
+    char *buffer;  /* Events that have not been written to the file yet */
+    size_t length;  /* The number of bytes in buffer */
+} Event_Log;
+
+Event_Log *Event_Log_Open(const char *path, Event_Format format);  /* Create the file of an event stream (NULL on error) */
+int Event_Log_Close(Event_Log *log);  /* Write what is left in the buffer and release the stream (OK or ERROR) */
+void Event_Log_Flush(Event_Log *log);  /* Write the buffered events to the file */
+void Event_Log_Write(Event_Log *log, uint64_t reference, int process, Event_Type event, uint64_t page, int frame);  /* Add an event to the stream */
+
+#endif
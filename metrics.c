@@ -0,0 +1,259 @@
+#ifdef ENABLE_METRICS  /* The whole file (see metrics.h) */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+#include "ergasia2.h"
+#include "metrics.h"
+#include "simulator.h"
+
+static const char *section_names[] = {"lookup", "victim", "parse"};  /* Indexed by Metrics_Section */
+
+static uint64_t Metrics_Now(void) {  /* Monotonic time in nanoseconds */
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ull + now.tv_nsec;
+}
+
+static int Metrics_Open_Counter(void) {  /* Count the cycles of this thread in user space (INVALID if perf_event is not available) */
+#ifdef __linux__
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_CPU_CYCLES;
+    attr.exclude_kernel = 1;  /* The system calls that read the counter stay out of the counts (and no privileges are needed) */
+    attr.exclude_hv = 1;
+    long fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);  /* This thread, on whichever processor it runs */
+    return (fd >= 0) ? (int)fd : INVALID;
+#else
+    return INVALID;
+#endif
+}
+
+static uint64_t Metrics_Cycles(Metrics *metrics) {  /* The cycles the thread has spent in user space so far */
+    uint64_t cycles;
+    if (read(metrics->perf_fd, &cycles, sizeof(cycles)) != sizeof(cycles))
+        return 0;
+    return cycles;
+}
+
+static int Metrics_Bucket(uint64_t nanoseconds) {  /* The histogram bucket of a duration */
+    int bucket = (nanoseconds > 0) ? 63 - __builtin_clzll(nanoseconds) : 0;
+    return (bucket < METRICS_BUCKETS) ? bucket : METRICS_BUCKETS - 1;
+}
+
+Metrics *Metrics_Open(const char *path, Metrics_Format format, long long interval, int num_of_processes, bool perf) {  /* Create the file of the time series (NULL on error). Without a perf_event counter, it says so and goes on without cycles */
+    Metrics *metrics = (Metrics *)calloc(1, sizeof(Metrics));
+    if (metrics == NULL)
+        return NULL;
+    metrics->format = format;
+    metrics->interval = interval;
+    metrics->num_of_processes = num_of_processes;
+    metrics->perf_fd = INVALID;
+    metrics->counters = (Metrics_Counters *)calloc(num_of_processes, sizeof(Metrics_Counters));
+    metrics->resident = (int *)malloc(num_of_processes * sizeof(int));
+    metrics->dirty = (int *)malloc(num_of_processes * sizeof(int));
+    metrics->file = fopen(path, "w");
+    if (metrics->counters == NULL || metrics->resident == NULL || metrics->dirty == NULL || metrics->file == NULL) {
+        if (metrics->file != NULL)
+            fclose(metrics->file);
+        free(metrics->counters);
+        free(metrics->resident);
+        free(metrics->dirty);
+        free(metrics);
+        return NULL;
+    }
+    if (format == METRICS_CSV)
+        fprintf(metrics->file, "reference,process,references,page_faults,fault_rate,resident_frames,dirty_ratio,ws_pages,disturbed\n");
+    else
+        fprintf(metrics->file, "{\"interval\": %lld, \"rows\": [", interval);
+    if (perf) {
+        metrics->perf_fd = Metrics_Open_Counter();
+        if (metrics->perf_fd == INVALID)
+            printf("NOTE: No perf_event cycle counter is available, the sections are only timed\n");
+    }
+    return metrics;
+}
+
+static void Metrics_Start(Metrics *metrics, Metrics_Section section) {  /* Start timing a section */
+    metrics->section_start_ns[section] = Metrics_Now();
+    if (metrics->perf_fd != INVALID)
+        metrics->section_start_cycles[section] = Metrics_Cycles(metrics);  /* Last, so the clock is not counted */
+}
+
+static void Metrics_Stop(Metrics *metrics, Metrics_Section section) {  /* Add the cost of a section since it started */
+    Metrics_Section_Cost *cost = &metrics->sections[section];
+    if (metrics->perf_fd != INVALID)
+        cost->cycles += Metrics_Cycles(metrics) - metrics->section_start_cycles[section];  /* First, for the same reason */
+    cost->nanoseconds += Metrics_Now() - metrics->section_start_ns[section];
+    cost->samples++;
+}
+
+void Metrics_Begin_Reference(Metrics *metrics, long long reference_count) {  /* A reference starts to get resolved (reference_count does not include it yet) */
+    metrics->sampled = ((reference_count + 1) % METRICS_SECTION_SAMPLE == 0);
+    metrics->reference_start = Metrics_Now();
+}
+
+void Metrics_Section_Begin(Metrics *metrics, Metrics_Section section) {  /* A section of a sampled reference starts */
+    if (metrics->sampled)
+        Metrics_Start(metrics, section);
+}
+
+void Metrics_Section_End(Metrics *metrics, Metrics_Section section) {  /* And ends */
+    if (metrics->sampled)
+        Metrics_Stop(metrics, section);
+}
+
+void Metrics_Parse_Begin(Metrics *metrics, const Trace_Reader *reader) {  /* The next reference of a trace is about to be taken (it gets timed if a batch has to be parsed for it) */
+    metrics->parsing = (reader != NULL && reader->batch_next == reader->batch_length);  /* Preloaded traces are never parsed here */
+    if (metrics->parsing)
+        Metrics_Start(metrics, METRICS_PARSE);
+}
+
+void Metrics_Parse_End(Metrics *metrics) {  /* The reference has been taken */
+    if (metrics->parsing)
+        Metrics_Stop(metrics, METRICS_PARSE);
+    metrics->parsing = FALSE;
+}
+
+void Metrics_Disturb(Metrics *metrics, int pid) {  /* The working set of a process gave up a page to another one */
+    metrics->counters[pid].disturbed++;
+}
+
+static void Metrics_Write_Name(FILE *file, const char *name) {  /* A JSON string (the name of a trace may contain anything) */
+    fputc('"', file);
+    for (const char *c = name; *c != '\0'; c++) {
+        if (*c == '"' || *c == '\\')
+            fputc('\\', file);
+        if ((unsigned char)*c >= ' ')
+            fputc(*c, file);
+    }
+    fputc('"', file);
+}
+
+static void Metrics_Write_Rows(Simulator *sim) {  /* A row per process for the interval that just ended */
+    Metrics *metrics = sim->metrics;
+    memset(metrics->resident, 0, metrics->num_of_processes * sizeof(int));
+    memset(metrics->dirty, 0, metrics->num_of_processes * sizeof(int));
+    for (int frame = 0; frame < sim->config.num_of_frames; frame++) {
+        if (Bitmap_Test(sim->IPT.valid, frame)) {
+            metrics->resident[sim->IPT.pids[frame]]++;
+            metrics->dirty[sim->IPT.pids[frame]] += Bitmap_Test(sim->IPT.modified, frame);
+        }
+    }
+    bool working_sets = Algorithm_Uses_Working_Sets(sim->config.algorithm);
+    for (int pid = 0; pid < metrics->num_of_processes; pid++) {
+        Metrics_Counters *counters = &metrics->counters[pid];
+        int ws_pages = 0;
+        for (unsigned int cell = 0; working_sets && cell <= sim->processes[pid].working_set.mask; cell++) {  /* Each page of the working set has a cell */
+            ws_pages += (sim->processes[pid].working_set.pages[cell] != NO_PAGE);
+        }
+        double fault_rate = (counters->references > 0) ? (double)counters->page_faults / counters->references : 0;
+        double dirty_ratio = (metrics->resident[pid] > 0) ? (double)metrics->dirty[pid] / metrics->resident[pid] : 0;
+        if (metrics->format == METRICS_CSV) {
+            fprintf(metrics->file, "%lld,%s,%lld,%lld,%.6f,%d,%.6f,", sim->reference_count, sim->processes[pid].name, counters->references, counters->page_faults, fault_rate, metrics->resident[pid], dirty_ratio);
+            if (working_sets)
+                fprintf(metrics->file, "%d", ws_pages);
+            fprintf(metrics->file, ",%lld\n", counters->disturbed);
+        }
+        else {
+            fprintf(metrics->file, "%s\n{\"reference\": %lld, \"process\": ", (metrics->num_of_rows > 0) ? "," : "", sim->reference_count);
+            Metrics_Write_Name(metrics->file, sim->processes[pid].name);
+            fprintf(metrics->file, ", \"references\": %lld, \"page_faults\": %lld, \"fault_rate\": %.6f, \"resident_frames\": %d, \"dirty_ratio\": %.6f, \"ws_pages\": ", counters->references, counters->page_faults, fault_rate, metrics->resident[pid], dirty_ratio);
+            if (working_sets)
+                fprintf(metrics->file, "%d", ws_pages);
+            else
+                fprintf(metrics->file, "null");
+            fprintf(metrics->file, ", \"disturbed\": %lld}", counters->disturbed);
+        }
+        metrics->num_of_rows++;
+    }
+    memset(metrics->counters, 0, metrics->num_of_processes * sizeof(Metrics_Counters));  /* The next interval starts */
+    metrics->last_row = sim->reference_count;
+}
+
+void Metrics_End_Reference(Simulator *sim, int pid, bool page_fault) {  /* The reference has been resolved (and counted in sim->reference_count) */
+    Metrics *metrics = sim->metrics;
+    int bucket = Metrics_Bucket(Metrics_Now() - metrics->reference_start);
+    if (page_fault)
+        metrics->fault_latency[bucket]++;
+    else
+        metrics->hit_latency[bucket]++;
+    metrics->counters[pid].references++;
+    metrics->counters[pid].page_faults += page_fault;
+    if (sim->reference_count - metrics->last_row >= metrics->interval)
+        Metrics_Write_Rows(sim);
+}
+
+static void Metrics_Write_Histogram(FILE *file, const uint64_t *histogram) {  /* A JSON array with a count per bucket */
+    fputc('[', file);
+    for (int bucket = 0; bucket < METRICS_BUCKETS; bucket++) {
+        fprintf(file, "%s%llu", (bucket > 0) ? ", " : "", (unsigned long long)histogram[bucket]);
+    }
+    fputc(']', file);
+}
+
+static void Metrics_Show(Metrics *metrics) {  /* The latencies and the cost of the sections, after the Results block */
+    printf("Metrics:\n");
+    printf("Time to resolve a reference (ns)      hits     faults\n");
+    for (int bucket = 0; bucket < METRICS_BUCKETS; bucket++) {
+        if (metrics->hit_latency[bucket] == 0 && metrics->fault_latency[bucket] == 0)
+            continue;
+        char range[32];
+        snprintf(range, sizeof(range), "[%llu, %llu)", (bucket > 0) ? 1ull << bucket : 0ull, 1ull << (bucket + 1));
+        printf("%-32s %10llu %10llu\n", range, (unsigned long long)metrics->hit_latency[bucket], (unsigned long long)metrics->fault_latency[bucket]);
+    }
+    for (int section = 0; section < METRICS_NUM_OF_SECTIONS; section++) {
+        Metrics_Section_Cost *cost = &metrics->sections[section];
+        if (cost->samples == 0)
+            continue;
+        printf("%s: %lld samples, %.1f ns", section_names[section], cost->samples, (double)cost->nanoseconds / cost->samples);
+        if (metrics->perf_fd != INVALID)
+            printf(", %.1f cycles", (double)cost->cycles / cost->samples);
+        printf(" on average\n");
+    }
+    printf("\n");
+}
+
+int Metrics_Close(Metrics *metrics, Simulator *sim) {  /* Write the last (partial) interval and the latencies, show a summary of them and release everything (OK or ERROR) */
+    if (sim->reference_count > metrics->last_row)
+        Metrics_Write_Rows(sim);
+    if (metrics->format == METRICS_JSON) {
+        fprintf(metrics->file, "\n], \"latency\": {\"unit\": \"ns\", \"bucket\": \"[2^i, 2^(i+1))\", \"hits\": ");
+        Metrics_Write_Histogram(metrics->file, metrics->hit_latency);
+        fprintf(metrics->file, ", \"faults\": ");
+        Metrics_Write_Histogram(metrics->file, metrics->fault_latency);
+        fprintf(metrics->file, "}, \"sections\": {");
+        for (int section = 0; section < METRICS_NUM_OF_SECTIONS; section++) {
+            Metrics_Section_Cost *cost = &metrics->sections[section];
+            fprintf(metrics->file, "%s\"%s\": {\"samples\": %lld, \"nanoseconds\": %llu, \"cycles\": ", (section > 0) ? ", " : "", section_names[section], cost->samples, (unsigned long long)cost->nanoseconds);
+            if (metrics->perf_fd != INVALID)
+                fprintf(metrics->file, "%llu}", (unsigned long long)cost->cycles);
+            else
+                fprintf(metrics->file, "null}");
+        }
+        fprintf(metrics->file, "}}\n");
+    }
+    Metrics_Show(metrics);
+    int status = ferror(metrics->file) ? ERROR : OK;
+    if (fclose(metrics->file) != 0)  /* Closed even after a write error */
+        status = ERROR;
+    if (metrics->perf_fd != INVALID)
+        close(metrics->perf_fd);
+    free(metrics->counters);
+    free(metrics->resident);
+    free(metrics->dirty);
+    free(metrics);
+    return status;
+}
+
+#endif
@@ -0,0 +1,95 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "trace.h"
+
+/* Time series of a simulation and the cost of its hot paths. Built only with "make METRICS=1", which defines
+   ENABLE_METRICS: otherwise METRICS_HOOK expands to nothing and the simulator carries no trace of it.
+
+   Every interval references (and once more at the end) a row per process is written with what happened
+   in the interval: references, page faults, the frames it holds, how many of them are dirty, the pages of
+   its working set (WS only) and how many times its working set got disturbed. Besides that, the time
+   each reference took to resolve (hits and faults apart) is kept in log2 histograms of nanoseconds, and
+   every METRICS_SECTION_SAMPLE-th reference times the IPT lookup and the victim selection, as does
+   every batch of the traces that gets parsed. With --metrics-perf those sections also count the cycles
+   of the thread in user space, through a perf_event counter (Linux only).
+
+   CSV:  "reference,process,references,page_faults,fault_rate,resident_frames,dirty_ratio,ws_pages,disturbed"
+         per row (ws_pages is empty without working sets)
+   JSON: {"interval": n, "rows": [{...}, ...], "latency": {...}, "sections": {...}}, with the same fields */
+
+#define METRICS_DEFAULT_INTERVAL 10000  /* References per row */
+
+#ifdef ENABLE_METRICS
+
+#define METRICS_HOOK(metrics, call) do { if ((metrics) != NULL) call; } while (0)  /* A call that only happens if metrics are collected */
+#define METRICS_BUCKETS 40  /* Bucket i counts the durations of [2^i, 2^(i+1)) nanoseconds (bucket 0 also counts 0) */
+#define METRICS_SECTION_SAMPLE 64  /* Every how many references the lookup and the victim selection are timed */
+
+typedef struct Simulator_Type Simulator;  /* The simulation the rows describe (see simulator.h) */
+
+typedef enum Metrics_Format {
+    METRICS_CSV,
+    METRICS_JSON
+} Metrics_Format;
+
+typedef enum Metrics_Section {  /* The parts of the hot path that are timed */
+    METRICS_LOOKUP,  /* Finding the frame of a page in the IPT */
+    METRICS_VICTIM,  /* Choosing the frame to replace */
+    METRICS_PARSE,  /* Parsing (or, for a streamed trace, taking over) the next batch of references */
+    METRICS_NUM_OF_SECTIONS
+} Metrics_Section;
+
+typedef struct Metrics_Counters_Type {  /* What happened to a process during the current interval */
+    long long references;
+    long long page_faults;
+    long long disturbed;  /* How many times its working set had to give up a page to another process */
+} Metrics_Counters;
+
+typedef struct Metrics_Section_Cost_Type {  /* The accumulated cost of a section */
+    long long samples;
+    uint64_t nanoseconds;
+    uint64_t cycles;  /* Only with --metrics-perf */
+} Metrics_Section_Cost;
+
+typedef struct Metrics_Type {
+    FILE *file;
+    Metrics_Format format;
+    long long interval;  /* A row per process every this many references */
+    int num_of_processes;
+    Metrics_Counters *counters;  /* Of each process, reset after every interval */
+    long long last_row;  /* The overall number of the reference that ended the last interval */
+    long long num_of_rows;
+    int *resident;  /* Scratch space for the rows: the frames of each process */
+    int *dirty;  /* And how many of them are modified */
+    uint64_t hit_latency[METRICS_BUCKETS];  /* Histograms of the time to resolve a reference */
+    uint64_t fault_latency[METRICS_BUCKETS];
+    uint64_t reference_start;  /* When the current reference started to get resolved (ns) */
+    bool sampled;  /* Whether the lookup and the victim selection of the current reference are timed */
+    bool parsing;  /* Whether a batch is being parsed (and timed) for the next reference */
+    int perf_fd;  /* The cycle counter of the thread (INVALID without --metrics-perf) */
+    uint64_t section_start_ns[METRICS_NUM_OF_SECTIONS];
+    uint64_t section_start_cycles[METRICS_NUM_OF_SECTIONS];
+    Metrics_Section_Cost sections[METRICS_NUM_OF_SECTIONS];
+} Metrics;
+
+Metrics *Metrics_Open(const char *path, Metrics_Format format, long long interval, int num_of_processes, bool perf);  /* Create the file of the time series (NULL on error). Without a perf_event counter, it says so and goes on without cycles */
+void Metrics_Begin_Reference(Metrics *metrics, long long reference_count);  /* A reference starts to get resolved (reference_count does not include it yet) */
+void Metrics_End_Reference(Simulator *sim, int pid, bool page_fault);  /* The reference has been resolved (and counted in sim->reference_count) */
+void Metrics_Disturb(Metrics *metrics, int pid);  /* The working set of a process gave up a page to another one */
+void Metrics_Section_Begin(Metrics *metrics, Metrics_Section section);  /* A section of a sampled reference starts */
+void Metrics_Section_End(Metrics *metrics, Metrics_Section section);  /* And ends */
+void Metrics_Parse_Begin(Metrics *metrics, const Trace_Reader *reader);  /* The next reference of a trace is about to be taken (it gets timed if a batch has to be parsed for it) */
+void Metrics_Parse_End(Metrics *metrics);  /* The reference has been taken */
+int Metrics_Close(Metrics *metrics, Simulator *sim);  /* Write the last (partial) interval and the latencies, show a summary of them and release everything (OK or ERROR) */
+
+#else
+
+#define METRICS_HOOK(metrics, call) do { } while (0)
+
+#endif
+
+#endif
@@ -0,0 +1,294 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "ergasia2.h"
+#include "mrc.h"
+
+#define MRC_INITIAL_CAPACITY 1024  /* Initial number of pages of the map and of times of the tree (both grow as needed) */
+
+typedef struct LRU_Stack_Type {  /* The LRU stack of every page referenced so far, ordered by the time of its last reference */
+    uint64_t *page_nums;  /* The page_num of each page, indexed by its id (ids are given in order of first reference) */
+    int *pids;  /* The pid of each page, indexed by its id */
+    int *last_time;  /* The time of the last reference to each page, indexed by its id */
+    int num_of_pages;  /* Every page stays in the stack, so this is also the number of marked times */
+    int pages_capacity;
+    int *cells;  /* Hash map (open addressing) from (pid, page_num) to id. INVALID marks an empty cell */
+    unsigned int mask;  /* The number of cells minus 1 (the number of cells is a power of 2) */
+    int *tree;  /* Fenwick tree over the times (1-based): a time is marked while it is the last reference to its page */
+    int *time_page;  /* The id of the page referenced at each time (INVALID once that page is referenced again) */
+    int capacity;  /* The number of times the tree covers. When they run out, the marked times are renumbered from 0 */
+    int now;  /* The time of the next reference */
+} LRU_Stack;
+
+static unsigned int MRC_Hash(int pid, uint64_t page_num, unsigned int mask) {  /* Map (pid, page_num) to a cell of the hash map */
+    return Page_Hash(pid, page_num) & mask;
+}
+
+static void Fenwick_Add(int *tree, int capacity, int time, int delta) {  /* Add delta to the mark of a time */
+    for (int i = time + 1; i <= capacity; i += i & -i) {
+        tree[i] += delta;
+    }
+}
+
+static int Fenwick_Prefix(int *tree, int time) {  /* The number of marked times from 0 to the given time (inclusive) */
+    int sum = 0;
+    for (int i = time + 1; i > 0; i -= i & -i) {
+        sum += tree[i];
+    }
+    return sum;
+}
+
+static bool LRU_Stack_Create(LRU_Stack *stack) {  /* Allocate an empty stack */
+    memset(stack, 0, sizeof(LRU_Stack));
+    stack->pages_capacity = stack->capacity = MRC_INITIAL_CAPACITY;
+    stack->mask = 2 * MRC_INITIAL_CAPACITY - 1;  /* The map is kept at most half full */
+    stack->page_nums = (uint64_t *)malloc(stack->pages_capacity * sizeof(uint64_t));
+    stack->pids = (int *)malloc(stack->pages_capacity * sizeof(int));
+    stack->last_time = (int *)malloc(stack->pages_capacity * sizeof(int));
+    stack->cells = (int *)malloc((stack->mask + 1) * sizeof(int));
+    stack->tree = (int *)calloc(stack->capacity + 1, sizeof(int));
+    stack->time_page = (int *)malloc(stack->capacity * sizeof(int));
+    if (stack->page_nums == NULL || stack->pids == NULL || stack->last_time == NULL || stack->cells == NULL || stack->tree == NULL || stack->time_page == NULL)
+        return FALSE;
+    for (unsigned int cell = 0; cell <= stack->mask; cell++) {
+        stack->cells[cell] = INVALID;
+    }
+    return TRUE;
+}
+
+static void LRU_Stack_Destroy(LRU_Stack *stack) {  /* Release the memory of a stack */
+    free(stack->page_nums);
+    free(stack->pids);
+    free(stack->last_time);
+    free(stack->cells);
+    free(stack->tree);
+    free(stack->time_page);
+}
+
+static bool LRU_Stack_Grow_Pages(LRU_Stack *stack) {  /* Double the room for pages and rebuild the hash map */
+    int capacity = 2 * stack->pages_capacity;
+    uint64_t *page_nums = (uint64_t *)realloc(stack->page_nums, capacity * sizeof(uint64_t));
+    if (page_nums == NULL)
+        return FALSE;
+    stack->page_nums = page_nums;
+    int *pids = (int *)realloc(stack->pids, capacity * sizeof(int));
+    if (pids == NULL)
+        return FALSE;
+    stack->pids = pids;
+    int *last_time = (int *)realloc(stack->last_time, capacity * sizeof(int));
+    if (last_time == NULL)
+        return FALSE;
+    stack->last_time = last_time;
+    unsigned int mask = 2 * capacity - 1;
+    int *cells = (int *)malloc((mask + 1) * sizeof(int));
+    if (cells == NULL)
+        return FALSE;
+    for (unsigned int cell = 0; cell <= mask; cell++) {
+        cells[cell] = INVALID;
+    }
+    for (int id = 0; id < stack->num_of_pages; id++) {
+        unsigned int cell = MRC_Hash(stack->pids[id], stack->page_nums[id], mask);
+        while (cells[cell] != INVALID) {
+            cell = (cell + 1) & mask;
+        }
+        cells[cell] = id;
+    }
+    free(stack->cells);
+    stack->cells = cells;
+    stack->mask = mask;
+    stack->pages_capacity = capacity;
+    return TRUE;
+}
+
+static bool LRU_Stack_Compact(LRU_Stack *stack) {  /* Renumber the marked times from 0 (keeping their order) and rebuild the tree, so there is room for new times */
+    int capacity = stack->capacity;
+    while (2 * stack->num_of_pages > capacity) {  /* Keep atleast half of the times free, so compactions stay rare */
+        capacity *= 2;
+    }
+    if (capacity > stack->capacity) {
+        int *tree = (int *)realloc(stack->tree, (capacity + 1) * sizeof(int));
+        if (tree == NULL)
+            return FALSE;
+        stack->tree = tree;
+        int *time_page = (int *)realloc(stack->time_page, capacity * sizeof(int));
+        if (time_page == NULL)
+            return FALSE;
+        stack->time_page = time_page;
+        stack->capacity = capacity;
+    }
+    int marked = 0;
+    for (int time = 0; time < stack->now; time++) {  /* Slide the marked times down, in place */
+        int id = stack->time_page[time];
+        if (id != INVALID) {
+            stack->time_page[marked] = id;
+            stack->last_time[id] = marked++;
+        }
+    }
+    stack->now = marked;
+    memset(stack->tree, 0, (capacity + 1) * sizeof(int));
+    for (int i = 1; i <= capacity; i++) {  /* Build the tree in linear time */
+        if (i <= marked)
+            stack->tree[i]++;
+        int parent = i + (i & -i);
+        if (parent <= capacity)
+            stack->tree[parent] += stack->tree[i];
+    }
+    return TRUE;
+}
+
+static int LRU_Stack_Reference(LRU_Stack *stack, int pid, uint64_t page_num) {  /* Move a page to the top of the stack. Return its stack distance (0 on its first reference, INVALID if memory ran out) */
+    unsigned int cell = MRC_Hash(pid, page_num, stack->mask);
+    while (stack->cells[cell] != INVALID && (stack->page_nums[stack->cells[cell]] != page_num || stack->pids[stack->cells[cell]] != pid)) {
+        cell = (cell + 1) & stack->mask;
+    }
+    int id = stack->cells[cell];
+    int distance = 0;
+    if (id != INVALID) {  /* Referenced before: the pages above it are those marked after its last time */
+        int last_time = stack->last_time[id];
+        distance = stack->num_of_pages - Fenwick_Prefix(stack->tree, last_time) + 1;
+        Fenwick_Add(stack->tree, stack->capacity, last_time, -1);
+        stack->time_page[last_time] = INVALID;
+    }
+    else {  /* First reference: a new page joins the stack */
+        if (stack->num_of_pages == stack->pages_capacity) {
+            if (!LRU_Stack_Grow_Pages(stack))
+                return INVALID;
+            cell = MRC_Hash(pid, page_num, stack->mask);
+            while (stack->cells[cell] != INVALID) {
+                cell = (cell + 1) & stack->mask;
+            }
+        }
+        id = stack->num_of_pages++;
+        stack->page_nums[id] = page_num;
+        stack->pids[id] = pid;
+        stack->cells[cell] = id;
+    }
+    if (stack->now == stack->capacity && !LRU_Stack_Compact(stack))
+        return INVALID;
+    Fenwick_Add(stack->tree, stack->capacity, stack->now, +1);
+    stack->time_page[stack->now] = id;
+    stack->last_time[id] = stack->now++;
+    return distance;
+}
+
+int MRC_Run(const MRC_Spec *spec) {  /* Write a CSV row (frames, page faults overall and of each process) for every number of frames up to the one that only has compulsory faults (OK or ERROR) */
+    /* The simulator only schedules the references (round robin, q at a time). None of them gets resolved */
+    Simulator_Config config;
+    memset(&config, 0, sizeof(config));
+    config.algorithm = ALGORITHM_LRU;
+    config.lru_scan = TRUE;  /* No recency list to keep */
+    config.num_of_frames = 1;
+    config.q = spec->q;
+    config.ws_size = INVALID;
+    config.max_num_of_references = spec->max_num_of_references;
+    config.layout = spec->layout;
+    config.trace_paths = spec->trace_paths;
+    config.num_of_processes = spec->num_of_processes;
+    config.verbosity = VERBOSITY_SUMMARY;
+    config.sample_interval = 1;
+    config.events = NULL;
+    config.preloaded = NULL;
+    Simulator sim;
+    LRU_Stack stack;
+    int num_of_processes = spec->num_of_processes;
+    long long **histograms = (long long **)calloc(num_of_processes, sizeof(long long *));  /* How many references of each process had each stack distance */
+    int histogram_size = MRC_INITIAL_CAPACITY + 1;  /* Distances range from 1 to the number of pages */
+    int max_distance = 0;
+    memset(&stack, 0, sizeof(LRU_Stack));  /* So it can be destroyed at any point */
+    int status = Simulator_Create(&sim, &config);
+    if (status == OK && (!LRU_Stack_Create(&stack) || histograms == NULL))
+        status = ERROR;
+    for (int pid = 0; status == OK && pid < num_of_processes; pid++) {
+        histograms[pid] = (long long *)calloc(histogram_size, sizeof(long long));
+        if (histograms[pid] == NULL)
+            status = ERROR;
+    }
+    if (status != OK && sim.error[0] == '\0')
+        strcpy(sim.error, "An error occured during memory allocation");
+    
+    /* A single pass over the references */
+    int pid;
+    const Reference *reference;
+    while (status == OK && (reference = Simulator_Next_Reference(&sim, &pid)) != NULL) {
+        sim.reference_count++;
+        sim.processes[pid].references++;
+        if (reference->action != 'R' && reference->action != 'W') {
+            snprintf(sim.error, sizeof(sim.error), "Invalid reference detected in file %s", sim.processes[pid].name);
+            status = ERROR;
+            break;
+        }
+        int distance = LRU_Stack_Reference(&stack, pid, reference->page_num);
+        if (distance == INVALID) {
+            strcpy(sim.error, "An error occured during memory allocation");
+            status = ERROR;
+        }
+        else if (distance > 0) {  /* First references (distance 0) are faults with any number of frames */
+            if (distance >= histogram_size) {  /* The distance cannot exceed the number of pages, so grow along with them */
+                int size = 2 * histogram_size;
+                while (distance >= size) {
+                    size *= 2;
+                }
+                for (int p = 0; p < num_of_processes; p++) {
+                    long long *histogram = (long long *)realloc(histograms[p], size * sizeof(long long));
+                    if (histogram == NULL) {
+                        strcpy(sim.error, "An error occured during memory allocation");
+                        status = ERROR;
+                        break;
+                    }
+                    memset(histogram + histogram_size, 0, (size - histogram_size) * sizeof(long long));
+                    histograms[p] = histogram;
+                }
+                if (status != OK)
+                    break;
+                histogram_size = size;
+            }
+            histograms[pid][distance]++;
+            if (distance > max_distance)
+                max_distance = distance;
+        }
+    }
+    
+    /* With k frames, the faults are the compulsory ones plus the references with distance above k */
+    if (status == OK) {
+        FILE *output = spec->output;
+        fprintf(output, "frames,page_faults,miss_ratio");
+        for (int p = 0; p < num_of_processes; p++) {
+            fprintf(output, ",%s_faults", sim.processes[p].name);
+        }
+        fprintf(output, "\n");
+        long long *faults = (long long *)malloc(num_of_processes * sizeof(long long));
+        if (faults == NULL) {
+            strcpy(sim.error, "An error occured during memory allocation");
+            status = ERROR;
+        }
+        for (int p = 0; status == OK && p < num_of_processes; p++) {  /* With 0 frames every reference is a fault */
+            faults[p] = sim.processes[p].references;
+        }
+        for (int frames = 1; status == OK && frames <= (max_distance > 0 ? max_distance : 1); frames++) {
+            long long page_faults = 0;
+            for (int p = 0; p < num_of_processes; p++) {
+                faults[p] -= histograms[p][frames];  /* The references with this distance become hits */
+                page_faults += faults[p];
+            }
+            fprintf(output, "%d,%lld,%.6f", frames, page_faults, (sim.reference_count > 0) ? (double)page_faults / sim.reference_count : 0.0);
+            for (int p = 0; p < num_of_processes; p++) {
+                fprintf(output, ",%lld", faults[p]);
+            }
+            fprintf(output, "\n");
+        }
+        free(faults);
+    }
+    if (status != OK)
+        printf("%s\n", sim.error);
+    
+    if (histograms != NULL) {
+        for (int p = 0; p < num_of_processes; p++) {
+            free(histograms[p]);
+        }
+    }
+    free(histograms);
+    LRU_Stack_Destroy(&stack);
+    Simulator_Destroy(&sim);
+    return status;
+}
@@ -0,0 +1,24 @@
+#ifndef MRC_H
+#define MRC_H
+
+#include <stdio.h>
+#include "simulator.h"
+
+/* Miss ratio curve of LRU: the page faults for every number of frames, from a single pass over the references.
+   LRU is a stack algorithm (the pages in k frames are always among the pages in k + 1 frames), so a reference
+   is a hit with k frames exactly when its stack distance (the number of distinct pages, of any process,
+   referenced since the previous reference to its page, plus one) is at most k. The distances are counted with
+   a Fenwick tree over the time of the last reference to each loaded page, in O(log n) per reference. */
+
+typedef struct MRC_Spec_Type {  /* What the curve is computed for */
+    int q;  /* After q resolved references of one process continue to the next one */
+    long long max_num_of_references;  /* INVALID for no limit */
+    Address_Layout layout;
+    const char **trace_paths;
+    int num_of_processes;
+    FILE *output;  /* Where to write the curve */
+} MRC_Spec;
+
+int MRC_Run(const MRC_Spec *spec);  /* Write a CSV row (frames, page faults overall and of each process) for every number of frames up to the one that only has compulsory faults (OK or ERROR) */
+
+#endif
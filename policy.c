@@ -0,0 +1,1041 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "ergasia2.h"
+#include "policy.h"
+#include "checkpoint.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#define NEVER_USED_AGAIN INT64_MAX  /* The next use of a page that is not referenced again (OPT) */
+
+static void LRU_Push_Front(IPT_Table *IPT, Recency_List *list, int frame) {  /* Insert a frame (that is not in the list) as the most recently used */
+    IPT->lru_prev[frame] = INVALID;
+    IPT->lru_next[frame] = list->head;
+    if (list->head != INVALID)
+        IPT->lru_prev[list->head] = frame;
+    else
+        list->tail = frame;  /* The list was empty, so the frame is the least recently used aswell */
+    list->head = frame;
+}
+
+static void LRU_Remove(IPT_Table *IPT, Recency_List *list, int frame) {  /* Unlink a frame (that is in the list) */
+    if (IPT->lru_prev[frame] != INVALID)
+        IPT->lru_next[IPT->lru_prev[frame]] = IPT->lru_next[frame];
+    else
+        list->head = IPT->lru_next[frame];  /* The frame was the head */
+    if (IPT->lru_next[frame] != INVALID)
+        IPT->lru_prev[IPT->lru_next[frame]] = IPT->lru_prev[frame];
+    else
+        list->tail = IPT->lru_prev[frame];  /* The frame was the tail */
+}
+
+static void LRU_Move_To_Front(IPT_Table *IPT, Recency_List *list, int frame) {  /* Mark a frame (that is in the list) as the most recently used */
+    if (list->head == frame)
+        return;  /* Already there */
+    IPT->lru_next[IPT->lru_prev[frame]] = IPT->lru_next[frame];  /* Unlink the frame (it is not the head, so it has a previous one) */
+    if (IPT->lru_next[frame] != INVALID)
+        IPT->lru_prev[IPT->lru_next[frame]] = IPT->lru_prev[frame];
+    else
+        list->tail = IPT->lru_prev[frame];  /* The frame was the tail, so its previous one is the new tail */
+    LRU_Push_Front(IPT, list, frame);
+}
+
+static bool Recency_List_Load(Recency_List *list, FILE *file, int num_of_frames) {  /* Read the ends of a list from a checkpoint (FALSE if they are not frames) */
+    return Checkpoint_Read(file, list, sizeof(Recency_List)) && list->head >= INVALID && list->head < num_of_frames && list->tail >= INVALID && list->tail < num_of_frames;
+}
+
+static unsigned int WS_Hash(uint64_t page_num, unsigned int mask) {  /* Map a page to a cell of the hash map of a working set */
+    return (unsigned int)((page_num * 0x9E3779B97F4A7C15ull) >> 40) & mask;  /* Fibonacci hashing, keeping the high bits that depend on every bit of the page */
+}
+
+static bool WS_Create(Working_Set *ws, int ws_size) {  /* Allocate an empty working set of the given size */
+    size_t num_of_cells = 1;  /* Up to 2^31 (ws_size is at most MAX_NUM_OF_FRAMES), so the mask still fits */
+    while (num_of_cells < 2 * (size_t)ws_size)  /* Keep the hash map at most half full, so the probe sequences stay short */
+        num_of_cells *= 2;
+    ws->size = ws_size;
+    ws->oldest = 0;
+    ws->mask = num_of_cells - 1;
+    ws->window = (uint64_t *)malloc(ws_size * sizeof(uint64_t));
+    ws->pages = (uint64_t *)malloc(num_of_cells * sizeof(uint64_t));
+    ws->counts = (int *)malloc(num_of_cells * sizeof(int));
+    if (ws->window == NULL || ws->pages == NULL || ws->counts == NULL)
+        return FALSE;
+    for (int i = 0; i < ws_size; i++) {
+        ws->window[i] = NO_PAGE;  /* Initially each slot contains trash (not a valid page number) */
+    }
+    for (size_t cell = 0; cell < num_of_cells; cell++) {
+        ws->pages[cell] = NO_PAGE;  /* Initially the hash map is empty */
+    }
+    return TRUE;
+}
+
+static void WS_Destroy(Working_Set *ws) {  /* Release the memory of a working set */
+    free(ws->window);
+    free(ws->pages);
+    free(ws->counts);
+}
+
+static int WS_Find_Cell(Working_Set *ws, uint64_t page_num) {  /* Find the cell of the hash map that holds the page, or else the empty cell where it would be inserted */
+    unsigned int cell = WS_Hash(page_num, ws->mask);
+    while (ws->pages[cell] != NO_PAGE && ws->pages[cell] != page_num)
+        cell = (cell + 1) & ws->mask;  /* Linear probing */
+    return cell;
+}
+
+static bool WS_Decrease_Count(Working_Set *ws, uint64_t page_num) {  /* One slot less holds this page. Return TRUE if the page left the working set */
+    unsigned int cell = WS_Find_Cell(ws, page_num);
+    if (--ws->counts[cell] > 0)
+        return FALSE;
+    /* Delete the cell by shifting back the following cells of the cluster, so no probe sequence gets broken */
+    unsigned int hole = cell;
+    for (unsigned int next = (hole + 1) & ws->mask; ws->pages[next] != NO_PAGE; next = (next + 1) & ws->mask) {
+        unsigned int home = WS_Hash(ws->pages[next], ws->mask);  /* The cell where the probe sequence of this page starts */
+        if (((next - home) & ws->mask) >= ((next - hole) & ws->mask)) {  /* The hole lies on the probe sequence of this page, so move it there */
+            ws->pages[hole] = ws->pages[next];
+            ws->counts[hole] = ws->counts[next];
+            hole = next;
+        }
+    }
+    ws->pages[hole] = NO_PAGE;
+    return TRUE;
+}
+
+static uint64_t WS_Insert_Page(Working_Set *ws, uint64_t page_num) {  /* Insert page to working set. Return the page that expired and left the working set (or NO_PAGE) */
+    unsigned int cell = WS_Find_Cell(ws, page_num);
+    if (ws->pages[cell] == NO_PAGE) {  /* The page joins the working set */
+        ws->pages[cell] = page_num;
+        ws->counts[cell] = 0;
+    }
+    ws->counts[cell]++;  /* Count the newcomer before the expiration, so a page that is both inserted and expired stays */
+    uint64_t expired_page = ws->window[ws->oldest];  /* The reference that falls out of the window */
+    ws->window[ws->oldest] = page_num;  /* The newcomer takes its slot */
+    ws->oldest = (ws->oldest + 1) % ws->size;
+    if (expired_page != NO_PAGE && WS_Decrease_Count(ws, expired_page))
+        return expired_page;
+    return NO_PAGE;
+}
+
+static void WS_Remove_Page(Working_Set *ws, uint64_t page_num) {  /* Remove page from working set (only its oldest slot, as the shifting array used to do) */
+    for (int i = 0; i < ws->size; i++) {  /* This happens only when a working set gets disturbed, so a scan from the oldest slot is affordable */
+        int slot = (ws->oldest + i) % ws->size;
+        if (ws->window[slot] == page_num) {  /* If the specified page is found */
+            ws->window[slot] = NO_PAGE;  /* Release its slot */
+            WS_Decrease_Count(ws, page_num);
+            break;
+        }
+    }
+}
+
+static void WS_Rebuild(Working_Set *ws) {  /* Count the pages of a restored window into the (empty) hash map */
+    for (int slot = 0; slot < ws->size; slot++) {
+        if (ws->window[slot] == NO_PAGE)
+            continue;
+        unsigned int cell = WS_Find_Cell(ws, ws->window[slot]);
+        if (ws->pages[cell] == NO_PAGE) {
+            ws->pages[cell] = ws->window[slot];
+            ws->counts[cell] = 0;
+        }
+        ws->counts[cell]++;
+    }
+}
+
+static bool Frame_Set_Create(Frame_Set *set, int num_of_frames) {  /* Allocate an empty set for frames 0 to num_of_frames - 1 */
+    int num_of_bits = num_of_frames;
+    set->num_of_levels = 0;
+    do {
+        int num_of_words = (num_of_bits + 63) / 64;
+        set->levels[set->num_of_levels] = (uint64_t *)calloc(num_of_words, sizeof(uint64_t));  /* Zeroed, so initially the set is empty */
+        if (set->levels[set->num_of_levels++] == NULL)
+            return FALSE;
+        num_of_bits = num_of_words;  /* The next level has a bit per word of this one */
+    } while (num_of_bits > 1);
+    return TRUE;
+}
+
+static void Frame_Set_Destroy(Frame_Set *set) {  /* Release the memory of a set */
+    for (int level = 0; level < set->num_of_levels; level++) {
+        free(set->levels[level]);
+    }
+}
+
+static void Frame_Set_Add(Frame_Set *set, int frame) {  /* Insert a frame to the set */
+    for (int level = 0; level < set->num_of_levels; level++, frame /= 64) {
+        uint64_t *word = &set->levels[level][frame / 64];
+        bool was_empty = (*word == 0);
+        *word |= (uint64_t)1 << (frame % 64);
+        if (!was_empty)
+            break;  /* The upper levels already know that this word is not empty */
+    }
+}
+
+static void Frame_Set_Remove(Frame_Set *set, int frame) {  /* Remove a frame from the set (if it is there) */
+    for (int level = 0; level < set->num_of_levels; level++, frame /= 64) {
+        uint64_t *word = &set->levels[level][frame / 64];
+        *word &= ~((uint64_t)1 << (frame % 64));
+        if (*word != 0)
+            break;  /* The word is still not empty, so the upper levels stay as they are */
+    }
+}
+
+static int Frame_Set_First(Frame_Set *set) {  /* Find the lowest frame of the set (INVALID if the set is empty) */
+    if (set->levels[set->num_of_levels - 1][0] == 0)
+        return INVALID;
+    int position = 0;
+    for (int level = set->num_of_levels - 1; level >= 0; level--) {  /* Descend through the lowest non-empty word of each level */
+        position = position * 64 + __builtin_ctzll(set->levels[level][position]);
+    }
+    return position;
+}
+
+static bool Owner_Tree_Create(Owner_Tree *tree, int num_of_frames) {  /* Allocate a tree where no frame is owned yet */
+    tree->num_of_leaves = 1;
+    while (tree->num_of_leaves < num_of_frames)
+        tree->num_of_leaves *= 2;
+    tree->nodes = (int *)malloc(2 * (size_t)tree->num_of_leaves * sizeof(int));
+    if (tree->nodes == NULL)
+        return FALSE;
+    for (int leaf = 0; leaf < tree->num_of_leaves; leaf++) {
+        tree->nodes[tree->num_of_leaves + leaf] = (leaf < num_of_frames) ? INVALID : OWNER_PADDING;  /* Empty frames belong to nobody */
+    }
+    for (int node = tree->num_of_leaves - 1; node >= 1; node--) {
+        int left = tree->nodes[2 * node], right = tree->nodes[2 * node + 1];
+        tree->nodes[node] = (left == right || right == OWNER_PADDING) ? left : (left == OWNER_PADDING ? right : OWNER_MIXED);
+    }
+    return TRUE;
+}
+
+static void Owner_Tree_Set(Owner_Tree *tree, int frame, int owner) {  /* Record the new owner of a frame */
+    int node = tree->num_of_leaves + frame;
+    tree->nodes[node] = owner;
+    for (node /= 2; node >= 1; node /= 2) {  /* Update the ancestors */
+        int left = tree->nodes[2 * node], right = tree->nodes[2 * node + 1];
+        tree->nodes[node] = (left == right || right == OWNER_PADDING) ? left : (left == OWNER_PADDING ? right : OWNER_MIXED);
+    }
+}
+
+static int Owner_Tree_First_Not_Owned_By(Owner_Tree *tree, int owner) {  /* Find the lowest frame that does not belong to the given owner (INVALID if there is none) */
+    #define SKIPPABLE(node) (tree->nodes[node] == owner || tree->nodes[node] == OWNER_PADDING)  /* Every frame of this subtree belongs to the owner */
+    if (SKIPPABLE(1))
+        return INVALID;
+    int node = 1;
+    while (node < tree->num_of_leaves) {  /* A subtree that is not skippable contains at least one frame of someone else */
+        node = SKIPPABLE(2 * node) ? 2 * node + 1 : 2 * node;  /* Prefer the left child, which holds the lower frames */
+    }
+    #undef SKIPPABLE
+    return node - tree->num_of_leaves;
+}
+
+typedef struct Ghost_Set_Type {  /* Pages (pid, page_num) that were evicted recently, each kept in one of two lists (ARC and 2Q) */
+    uint64_t *page_nums;  /* The page of each node */
+    int *pids;  /* The process of that page */
+    int *prev;  /* The node inserted right after this one in the same list (INVALID for the head) */
+    int *next;  /* The node inserted right before this one in the same list (INVALID for the tail). Also links the free nodes */
+    int *chain;  /* The next node whose page falls in the same slot of the anchors */
+    unsigned char *list;  /* The list of each node */
+    int *anchors;  /* Leads from a page to a chain of nodes */
+    unsigned int mask;  /* The number of anchors minus 1 (the number of anchors is a power of 2) */
+    int free_nodes;  /* Stack of unused nodes (INVALID if none is left) */
+    int head[2];  /* The newest node of each list */
+    int tail[2];  /* The oldest node of each list, which is forgotten first */
+    int length[2];
+} Ghost_Set;
+
+static bool Ghost_Set_Create(Ghost_Set *set, int capacity) {  /* Allocate an empty set that can hold the given number of pages */
+    size_t num_of_anchors = 1;  /* Up to 2^31 for a capacity of MAX_NUM_OF_FRAMES + 1 */
+    while (num_of_anchors < (size_t)capacity)
+        num_of_anchors *= 2;
+    set->mask = num_of_anchors - 1;
+    set->page_nums = (uint64_t *)malloc(capacity * sizeof(uint64_t));
+    set->pids = (int *)malloc(capacity * sizeof(int));
+    set->prev = (int *)malloc(capacity * sizeof(int));
+    set->next = (int *)malloc(capacity * sizeof(int));
+    set->chain = (int *)malloc(capacity * sizeof(int));
+    set->list = (unsigned char *)malloc(capacity);
+    set->anchors = (int *)malloc(num_of_anchors * sizeof(int));
+    if (set->page_nums == NULL || set->pids == NULL || set->prev == NULL || set->next == NULL || set->chain == NULL || set->list == NULL || set->anchors == NULL)
+        return FALSE;
+    for (size_t anchor = 0; anchor < num_of_anchors; anchor++) {
+        set->anchors[anchor] = INVALID;
+    }
+    set->free_nodes = INVALID;
+    for (int node = capacity - 1; node >= 0; node--) {
+        set->next[node] = set->free_nodes;
+        set->free_nodes = node;
+    }
+    for (int list = 0; list < 2; list++) {
+        set->head[list] = set->tail[list] = INVALID;
+        set->length[list] = 0;
+    }
+    return TRUE;
+}
+
+static void Ghost_Set_Destroy(Ghost_Set *set) {  /* Release the memory of a set */
+    free(set->page_nums);
+    free(set->pids);
+    free(set->prev);
+    free(set->next);
+    free(set->chain);
+    free(set->list);
+    free(set->anchors);
+}
+
+static int Ghost_Find(Ghost_Set *set, int pid, uint64_t page_num) {  /* The node that holds the page (INVALID if it is not in the set) */
+    for (int node = set->anchors[Page_Hash(pid, page_num) & set->mask]; node != INVALID; node = set->chain[node]) {
+        if (set->page_nums[node] == page_num && set->pids[node] == pid)
+            return node;
+    }
+    return INVALID;
+}
+
+static void Ghost_Remove(Ghost_Set *set, int node) {  /* Forget the page of a node */
+    int list = set->list[node];
+    if (set->prev[node] != INVALID)
+        set->next[set->prev[node]] = set->next[node];
+    else
+        set->head[list] = set->next[node];
+    if (set->next[node] != INVALID)
+        set->prev[set->next[node]] = set->prev[node];
+    else
+        set->tail[list] = set->prev[node];
+    set->length[list]--;
+    int *link = &set->anchors[Page_Hash(set->pids[node], set->page_nums[node]) & set->mask];
+    while (*link != node)
+        link = &set->chain[*link];
+    *link = set->chain[node];  /* Bypass the node in its chain */
+    set->next[node] = set->free_nodes;  /* The node can be used again */
+    set->free_nodes = node;
+}
+
+static void Ghost_Remove_Oldest(Ghost_Set *set, int list) {  /* Forget the oldest page of a list (if it is not empty) */
+    if (set->tail[list] != INVALID)
+        Ghost_Remove(set, set->tail[list]);
+}
+
+static void Ghost_Push_Front(Ghost_Set *set, int list, int pid, uint64_t page_num) {  /* Remember a page as the newest of a list */
+    if (set->free_nodes == INVALID)  /* The policies never hold more pages than the capacity, but stay safe */
+        Ghost_Remove_Oldest(set, (set->length[list] > 0) ? list : 1 - list);
+    int node = set->free_nodes;
+    set->free_nodes = set->next[node];
+    set->page_nums[node] = page_num;
+    set->pids[node] = pid;
+    set->list[node] = list;
+    set->prev[node] = INVALID;
+    set->next[node] = set->head[list];
+    if (set->head[list] != INVALID)
+        set->prev[set->head[list]] = node;
+    else
+        set->tail[list] = node;
+    set->head[list] = node;
+    set->length[list]++;
+    unsigned int anchor = Page_Hash(pid, page_num) & set->mask;
+    set->chain[node] = set->anchors[anchor];
+    set->anchors[anchor] = node;
+}
+
+static bool Ghost_Set_Save(Ghost_Set *set, FILE *file) {  /* Write the pages of both lists to a checkpoint, each list from its oldest page to its newest */
+    for (int list = 0; list < 2; list++) {
+        if (!Checkpoint_Write(file, &set->length[list], sizeof(int)))
+            return FALSE;
+        for (int node = set->tail[list]; node != INVALID; node = set->prev[node]) {
+            if (!Checkpoint_Write(file, &set->pids[node], sizeof(int)) || !Checkpoint_Write(file, &set->page_nums[node], sizeof(uint64_t)))
+                return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+static bool Ghost_Set_Load(Ghost_Set *set, FILE *file) {  /* Read the pages of an empty set back from a checkpoint (pushing each one as the newest rebuilds both lists) */
+    for (int list = 0; list < 2; list++) {
+        int length;
+        if (!Checkpoint_Read(file, &length, sizeof(int)) || length < 0)
+            return FALSE;
+        for (int i = 0; i < length; i++) {
+            int pid;
+            uint64_t page_num;
+            if (!Checkpoint_Read(file, &pid, sizeof(int)) || !Checkpoint_Read(file, &page_num, sizeof(uint64_t)))
+                return FALSE;
+            Ghost_Push_Front(set, list, pid, page_num);
+        }
+    }
+    return TRUE;
+}
+
+/* LRU: the recency list of the simulator, whose tail is the victim */
+
+static int LRU_Create(Simulator *sim) {
+    sim->recency_list.head = sim->recency_list.tail = INVALID;  /* Initially no frame is loaded */
+    return OK;
+}
+
+static void LRU_Destroy(Simulator *sim) {
+    (void)sim;
+}
+
+static void LRU_On_Hit(Simulator *sim, int pid, int frame) {
+    (void)pid;
+    LRU_Move_To_Front(&sim->IPT, &sim->recency_list, frame);  /* This frame is now the most recently used */
+}
+
+static void LRU_On_Fill(Simulator *sim, int pid, int frame) {
+    (void)pid;
+    LRU_Push_Front(&sim->IPT, &sim->recency_list, frame);  /* The frame joins the recency list */
+}
+
+static int LRU_Choose_Victim(Simulator *sim, int pid, uint64_t page_num, bool show) {
+    (void)pid, (void)page_num, (void)show;
+    return sim->recency_list.tail;  /* The least recently used frame hosts the page that will be replaced */
+}
+
+static void LRU_On_Evict(Simulator *sim, int frame) {
+    LRU_Remove(&sim->IPT, &sim->recency_list, frame);  /* It joins again as the most recently used, once the new page is loaded */
+}
+
+static int LRU_Save(Simulator *sim, FILE *file) {
+    return Checkpoint_Write(file, &sim->recency_list, sizeof(Recency_List)) ? OK : ERROR;  /* The links are part of the IPT */
+}
+
+static int LRU_Load(Simulator *sim, FILE *file) {
+    return Recency_List_Load(&sim->recency_list, file, sim->config.num_of_frames) ? OK : ERROR;
+}
+
+/* LRU reference implementation (--lru-scan): the victim is the frame with the min timestamp. The timestamps
+   are a separate array, so the scan reads nothing else, and on processors with AVX2 it compares 4 of them
+   per instruction (in 2 independent chains). The version is picked once, when the policy is created */
+
+typedef int (*Oldest_Frame_Finder)(const long long *timestamps, int num_of_frames);
+
+typedef struct LRU_Scan_State_Type {
+    Oldest_Frame_Finder find_oldest;
+} LRU_Scan_State;
+
+static void Nothing_On_Hit(Simulator *sim, int pid, int frame) {  /* For policies that keep no state per reference */
+    (void)sim, (void)pid, (void)frame;
+}
+
+static void Nothing_On_Evict(Simulator *sim, int frame) {
+    (void)sim, (void)frame;
+}
+
+static int Nothing_To_Checkpoint(Simulator *sim, FILE *file) {  /* For policies whose whole state is in the IPT */
+    (void)sim, (void)file;
+    return OK;
+}
+
+static int Oldest_Frame_Scalar(const long long *timestamps, int num_of_frames) {  /* The first frame with the min timestamp */
+    int frame_with_min_timestamp = 0;  /* This will show the frame that hosts the page with the min timestamp */
+    for (int frame = 1; frame < num_of_frames; frame++) {  /* Scan the timestamp of each frame */
+        if (timestamps[frame] < timestamps[frame_with_min_timestamp])  /* If the frame hosts a page with timestamp less than the min so far */
+            frame_with_min_timestamp = frame;  /* Save its position */
+    }
+    return frame_with_min_timestamp;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("avx2"))) static int Oldest_Frame_AVX2(const long long *timestamps, int num_of_frames) {  /* The first frame with the min timestamp, 4 frames per compare */
+    if (num_of_frames < 8)
+        return Oldest_Frame_Scalar(timestamps, num_of_frames);
+    __m256i min_low = _mm256_loadu_si256((const __m256i *)timestamps);
+    __m256i min_high = _mm256_loadu_si256((const __m256i *)(timestamps + 4));
+    int frame = 8;
+    for (; frame + 8 <= num_of_frames; frame += 8) {  /* Lane-wise min of 8 frames at a time */
+        __m256i low = _mm256_loadu_si256((const __m256i *)(timestamps + frame));
+        __m256i high = _mm256_loadu_si256((const __m256i *)(timestamps + frame + 4));
+        min_low = _mm256_blendv_epi8(min_low, low, _mm256_cmpgt_epi64(min_low, low));
+        min_high = _mm256_blendv_epi8(min_high, high, _mm256_cmpgt_epi64(min_high, high));
+    }
+    min_low = _mm256_blendv_epi8(min_low, min_high, _mm256_cmpgt_epi64(min_low, min_high));
+    long long lanes[4];
+    _mm256_storeu_si256((__m256i *)lanes, min_low);
+    long long min = lanes[0];
+    for (int lane = 1; lane < 4; lane++) {
+        if (lanes[lane] < min)
+            min = lanes[lane];
+    }
+    for (; frame < num_of_frames; frame++) {  /* The frames that did not fill a whole step */
+        if (timestamps[frame] < min)
+            min = timestamps[frame];
+    }
+    __m256i target = _mm256_set1_epi64x(min);  /* Now find the first frame that has it */
+    for (frame = 0; frame + 4 <= num_of_frames; frame += 4) {
+        __m256i equal = _mm256_cmpeq_epi64(_mm256_loadu_si256((const __m256i *)(timestamps + frame)), target);
+        int mask = _mm256_movemask_pd(_mm256_castsi256_pd(equal));
+        if (mask != 0)
+            return frame + __builtin_ctz(mask);
+    }
+    for (; timestamps[frame] != min; frame++)
+        ;
+    return frame;
+}
+#endif
+
+static int LRU_Scan_Create(Simulator *sim) {
+    LRU_Scan_State *scan = (LRU_Scan_State *)malloc(sizeof(LRU_Scan_State));
+    sim->policy_state = scan;
+    if (scan == NULL)
+        return Simulator_Fail(sim, "An error occured during memory allocation");
+    scan->find_oldest = Oldest_Frame_Scalar;
+#if defined(__x86_64__) || defined(__i386__)
+    if (__builtin_cpu_supports("avx2"))
+        scan->find_oldest = Oldest_Frame_AVX2;
+#endif
+    return OK;
+}
+
+static void LRU_Scan_Destroy(Simulator *sim) {
+    free(sim->policy_state);
+}
+
+static int LRU_Scan_Choose_Victim(Simulator *sim, int pid, uint64_t page_num, bool show) {
+    (void)pid, (void)page_num, (void)show;
+    return ((LRU_Scan_State *)sim->policy_state)->find_oldest(sim->IPT.timestamps, sim->config.num_of_frames);
+}
+
+/* WS: the victim is the lowest frame whose page is outside the working set of its process. If every page
+   belongs to a working set, the working set of another process gets disturbed */
+
+static int WS_Policy_Create(Simulator *sim) {
+    if (!Frame_Set_Create(&sim->frames_outside_ws, sim->config.num_of_frames) || !Owner_Tree_Create(&sim->owners, sim->config.num_of_frames))
+        return Simulator_Fail(sim, "An error occured during memory allocation");
+    for (int pid = 0; pid < sim->num_of_processes; pid++) {
+        if (!WS_Create(&sim->processes[pid].working_set, sim->config.ws_size))
+            return Simulator_Fail(sim, "An error occured during memory allocation");
+    }
+    return OK;
+}
+
+static void WS_Policy_Destroy(Simulator *sim) {
+    for (int pid = 0; sim->processes != NULL && pid < sim->num_of_processes; pid++) {
+        WS_Destroy(&sim->processes[pid].working_set);
+    }
+    Frame_Set_Destroy(&sim->frames_outside_ws);
+    free(sim->owners.nodes);
+}
+
+static void WS_On_Reference(Simulator *sim, int pid, int frame) {  /* Both a hit and a load add the page to the working set */
+    Owner_Tree_Set(&sim->owners, frame, pid);  /* The frame belongs to this process (it may have just changed hands) */
+    Frame_Set_Remove(&sim->frames_outside_ws, frame);  /* Its page is about to join the working set */
+    uint64_t expired_page = WS_Insert_Page(&sim->processes[pid].working_set, sim->IPT.page_nums[frame]);  /* Add this page to the working set of the process */
+    if (expired_page != NO_PAGE) {  /* A page left the working set, so if it is loaded its frame becomes a candidate victim */
+        int expired_frame = Simulator_Lookup(sim, pid, expired_page);
+        if (expired_frame != INVALID)
+            Frame_Set_Add(&sim->frames_outside_ws, expired_frame);
+    }
+}
+
+static int WS_Choose_Victim(Simulator *sim, int pid, uint64_t page_num, bool show) {
+    (void)page_num;
+    IPT_Table *IPT = &sim->IPT;
+    int frame = Frame_Set_First(&sim->frames_outside_ws);  /* The lowest frame whose page is not included by the working set of its process (INVALID if there is none) */
+    if (frame == INVALID) {  /* If every page belongs to a working set, disturb the working set of another process */
+        frame = Owner_Tree_First_Not_Owned_By(&sim->owners, pid);  /* The lowest frame whose page belongs to another process */
+        if (frame == INVALID) {  /* If even that didn't solve the problem, the frames are too few to support working sets of this size */
+            Simulator_Fail(sim, "ERROR: Given working set size (%d) cannot be satisfied by %d frames", sim->config.ws_size, sim->config.num_of_frames);
+            return INVALID;
+        }
+        Process *victim = &sim->processes[IPT->pids[frame]];
+        if (show)
+            printf("NOTE: Due to memory restriction %s had to disturb %s's working set in order to keep running\n", sim->processes[pid].name, victim->name);
+        WS_Remove_Page(&victim->working_set, IPT->page_nums[frame]);  /* Remove this page from the other process's working set */
+        METRICS_HOOK(sim->metrics, Metrics_Disturb(sim->metrics, IPT->pids[frame]));
+        if (sim->config.events != NULL)
+            Event_Log_Write(sim->config.events, sim->reference_count, IPT->pids[frame], EVENT_DISTURB, IPT->page_nums[frame], frame);
+    }
+    return frame;
+}
+
+static int WS_Save(Simulator *sim, FILE *file) {
+    for (int pid = 0; pid < sim->num_of_processes; pid++) {  /* The window of each process (the hash map follows from it) */
+        Working_Set *ws = &sim->processes[pid].working_set;
+        if (!Checkpoint_Write(file, ws->window, ws->size * sizeof(uint64_t)) || !Checkpoint_Write(file, &ws->oldest, sizeof(int)))
+            return ERROR;
+    }
+    size_t num_of_words = ((size_t)sim->config.num_of_frames + 63) / 64;
+    return Checkpoint_Write(file, sim->frames_outside_ws.levels[0], num_of_words * sizeof(uint64_t)) ? OK : ERROR;  /* The upper levels follow from the lowest one */
+}
+
+static int WS_Load(Simulator *sim, FILE *file) {
+    for (int pid = 0; pid < sim->num_of_processes; pid++) {
+        Working_Set *ws = &sim->processes[pid].working_set;
+        if (!Checkpoint_Read(file, ws->window, ws->size * sizeof(uint64_t)) || !Checkpoint_Read(file, &ws->oldest, sizeof(int)) || ws->oldest < 0 || ws->oldest >= ws->size)
+            return ERROR;
+        WS_Rebuild(ws);
+    }
+    int num_of_frames = sim->config.num_of_frames;
+    for (int word = 0; word < (num_of_frames + 63) / 64; word++) {
+        uint64_t bits;
+        if (!Checkpoint_Read(file, &bits, sizeof(uint64_t)))
+            return ERROR;
+        for (; bits != 0; bits &= bits - 1) {
+            int frame = word * 64 + __builtin_ctzll(bits);
+            if (frame >= num_of_frames)
+                return ERROR;
+            Frame_Set_Add(&sim->frames_outside_ws, frame);
+        }
+    }
+    for (int frame = 0; frame < num_of_frames; frame++) {  /* A loaded frame belongs to the process of its page */
+        if (Bitmap_Test(sim->IPT.valid, frame))
+            Owner_Tree_Set(&sim->owners, frame, sim->IPT.pids[frame]);
+    }
+    return OK;
+}
+
+/* CLOCK (second chance): the hand sweeps over the frames, clearing reference bits, until it finds a frame
+   that has not been referenced since the last sweep. Each bit is cleared once per set, so this is amortized O(1) */
+
+typedef struct Clock_State_Type {
+    unsigned char *referenced;  /* The reference bit of each frame */
+    int hand;  /* The next frame to examine */
+} Clock_State;
+
+static int Clock_Create(Simulator *sim) {
+    Clock_State *clock = (Clock_State *)calloc(1, sizeof(Clock_State));
+    sim->policy_state = clock;
+    if (clock == NULL || (clock->referenced = (unsigned char *)calloc(sim->config.num_of_frames, 1)) == NULL)
+        return Simulator_Fail(sim, "An error occured during memory allocation");
+    return OK;
+}
+
+static void Clock_Destroy(Simulator *sim) {
+    Clock_State *clock = (Clock_State *)sim->policy_state;
+    if (clock != NULL)
+        free(clock->referenced);
+    free(clock);
+}
+
+static void Clock_On_Reference(Simulator *sim, int pid, int frame) {
+    (void)pid;
+    ((Clock_State *)sim->policy_state)->referenced[frame] = TRUE;
+}
+
+static int Clock_Choose_Victim(Simulator *sim, int pid, uint64_t page_num, bool show) {
+    (void)pid, (void)page_num, (void)show;
+    Clock_State *clock = (Clock_State *)sim->policy_state;
+    while (clock->referenced[clock->hand]) {  /* Give a second chance */
+        clock->referenced[clock->hand] = FALSE;
+        clock->hand = (clock->hand + 1) % sim->config.num_of_frames;
+    }
+    int frame = clock->hand;
+    clock->hand = (clock->hand + 1) % sim->config.num_of_frames;
+    return frame;
+}
+
+static int Clock_Save(Simulator *sim, FILE *file) {
+    Clock_State *clock = (Clock_State *)sim->policy_state;
+    return (Checkpoint_Write(file, clock->referenced, sim->config.num_of_frames) && Checkpoint_Write(file, &clock->hand, sizeof(int))) ? OK : ERROR;
+}
+
+static int Clock_Load(Simulator *sim, FILE *file) {
+    Clock_State *clock = (Clock_State *)sim->policy_state;
+    if (!Checkpoint_Read(file, clock->referenced, sim->config.num_of_frames) || !Checkpoint_Read(file, &clock->hand, sizeof(int)))
+        return ERROR;
+    return (clock->hand >= 0 && clock->hand < sim->config.num_of_frames) ? OK : ERROR;
+}
+
+/* ARC (Megiddo and Modha): T1 holds the pages referenced once lately and T2 those referenced atleast twice.
+   B1 and B2 remember the pages recently evicted from each of them. A hit in B1 grows the target size p of T1
+   and a hit in B2 shrinks it, so the split between recency and frequency adapts to the references */
+
+typedef struct ARC_State_Type {
+    Recency_List lists[2];  /* T1 and T2 (through the lru links of the IPT) */
+    int length[2];
+    unsigned char *in_list;  /* Whether each frame is in T1 (0) or T2 (1) */
+    Ghost_Set ghosts;  /* B1 (list 0) and B2 (list 1) */
+    int target;  /* p, the target length of T1 */
+    int destination;  /* The ghost list that the victim goes to (INVALID to forget it) */
+} ARC_State;
+
+static int ARC_Create(Simulator *sim) {
+    ARC_State *arc = (ARC_State *)calloc(1, sizeof(ARC_State));
+    sim->policy_state = arc;
+    if (arc == NULL)
+        return Simulator_Fail(sim, "An error occured during memory allocation");
+    for (int list = 0; list < 2; list++) {
+        arc->lists[list].head = arc->lists[list].tail = INVALID;
+    }
+    arc->in_list = (unsigned char *)calloc(sim->config.num_of_frames, 1);
+    if (arc->in_list == NULL || !Ghost_Set_Create(&arc->ghosts, sim->config.num_of_frames + 1))  /* |B1| + |B2| never exceeds the number of frames */
+        return Simulator_Fail(sim, "An error occured during memory allocation");
+    arc->destination = INVALID;
+    return OK;
+}
+
+static void ARC_Destroy(Simulator *sim) {
+    ARC_State *arc = (ARC_State *)sim->policy_state;
+    if (arc != NULL) {
+        free(arc->in_list);
+        Ghost_Set_Destroy(&arc->ghosts);
+    }
+    free(arc);
+}
+
+static void ARC_On_Hit(Simulator *sim, int pid, int frame) {
+    (void)pid;
+    ARC_State *arc = (ARC_State *)sim->policy_state;
+    if (arc->in_list[frame] == 0) {  /* Referenced twice, so it moves from T1 to T2 */
+        LRU_Remove(&sim->IPT, &arc->lists[0], frame);
+        arc->length[0]--;
+        LRU_Push_Front(&sim->IPT, &arc->lists[1], frame);
+        arc->length[1]++;
+        arc->in_list[frame] = 1;
+    }
+    else
+        LRU_Move_To_Front(&sim->IPT, &arc->lists[1], frame);
+}
+
+static void ARC_On_Fill(Simulator *sim, int pid, int frame) {
+    ARC_State *arc = (ARC_State *)sim->policy_state;
+    int node = Ghost_Find(&arc->ghosts, pid, sim->IPT.page_nums[frame]);
+    int list = 0;  /* A new page joins T1 */
+    if (node != INVALID) {  /* A page that was evicted lately has been referenced again, so it joins T2 */
+        Ghost_Remove(&arc->ghosts, node);
+        list = 1;
+    }
+    LRU_Push_Front(&sim->IPT, &arc->lists[list], frame);
+    arc->length[list]++;
+    arc->in_list[frame] = list;
+}
+
+static int ARC_Replace(ARC_State *arc, bool in_b2) {  /* Evict from T1 if it is longer than its target, else from T2 */
+    int list = (arc->length[0] >= 1 && ((in_b2 && arc->length[0] == arc->target) || arc->length[0] > arc->target)) ? 0 : 1;
+    if (arc->length[list] == 0)
+        list = 1 - list;
+    arc->destination = list;  /* T1 goes to B1 and T2 to B2 */
+    return arc->lists[list].tail;
+}
+
+static int ARC_Choose_Victim(Simulator *sim, int pid, uint64_t page_num, bool show) {
+    (void)show;
+    ARC_State *arc = (ARC_State *)sim->policy_state;
+    int c = sim->config.num_of_frames;
+    int node = Ghost_Find(&arc->ghosts, pid, page_num);
+    if (node != INVALID && arc->ghosts.list[node] == 0) {  /* Hit in B1: favour recency */
+        int b1 = arc->ghosts.length[0], b2 = arc->ghosts.length[1];
+        arc->target += (b2 / b1 > 1) ? b2 / b1 : 1;
+        if (arc->target > c)
+            arc->target = c;
+        return ARC_Replace(arc, FALSE);
+    }
+    if (node != INVALID) {  /* Hit in B2: favour frequency */
+        int b1 = arc->ghosts.length[0], b2 = arc->ghosts.length[1];
+        arc->target -= (b1 / b2 > 1) ? b1 / b2 : 1;
+        if (arc->target < 0)
+            arc->target = 0;
+        return ARC_Replace(arc, TRUE);
+    }
+    if (arc->length[0] + arc->ghosts.length[0] == c) {  /* L1 (T1 and B1) is full */
+        if (arc->length[0] < c) {
+            Ghost_Remove_Oldest(&arc->ghosts, 0);
+            return ARC_Replace(arc, FALSE);
+        }
+        arc->destination = INVALID;  /* B1 is empty and T1 has every frame, so its LRU page is simply dropped */
+        return arc->lists[0].tail;
+    }
+    if (arc->length[0] + arc->length[1] + arc->ghosts.length[0] + arc->ghosts.length[1] == 2 * c)
+        Ghost_Remove_Oldest(&arc->ghosts, 1);  /* The directory is full, so forget the oldest page of B2 */
+    return ARC_Replace(arc, FALSE);
+}
+
+static void ARC_On_Evict(Simulator *sim, int frame) {
+    ARC_State *arc = (ARC_State *)sim->policy_state;
+    int list = arc->in_list[frame];
+    LRU_Remove(&sim->IPT, &arc->lists[list], frame);
+    arc->length[list]--;
+    if (arc->destination != INVALID)
+        Ghost_Push_Front(&arc->ghosts, arc->destination, sim->IPT.pids[frame], sim->IPT.page_nums[frame]);
+    arc->destination = INVALID;
+}
+
+static int ARC_Save(Simulator *sim, FILE *file) {  /* The destination is only set between the choice of a victim and its eviction */
+    ARC_State *arc = (ARC_State *)sim->policy_state;
+    bool written = Checkpoint_Write(file, arc->lists, sizeof(arc->lists)) && Checkpoint_Write(file, arc->length, sizeof(arc->length))
+        && Checkpoint_Write(file, arc->in_list, sim->config.num_of_frames) && Checkpoint_Write(file, &arc->target, sizeof(int));
+    return (written && Ghost_Set_Save(&arc->ghosts, file)) ? OK : ERROR;
+}
+
+static int ARC_Load(Simulator *sim, FILE *file) {
+    ARC_State *arc = (ARC_State *)sim->policy_state;
+    int num_of_frames = sim->config.num_of_frames;
+    bool read = Recency_List_Load(&arc->lists[0], file, num_of_frames) && Recency_List_Load(&arc->lists[1], file, num_of_frames)
+        && Checkpoint_Read(file, arc->length, sizeof(arc->length)) && Checkpoint_Read(file, arc->in_list, num_of_frames) && Checkpoint_Read(file, &arc->target, sizeof(int));
+    return (read && Ghost_Set_Load(&arc->ghosts, file)) ? OK : ERROR;
+}
+
+/* 2Q (Johnson and Shasha): a new page enters A1in (FIFO) and, if it is referenced again after leaving it
+   (while it is remembered in A1out), it joins Am (LRU). Pages referenced only once leave soon, without
+   pushing the frequently referenced ones out. A1in holds about 1/4 of the frames and A1out remembers 1/2 */
+
+typedef struct Two_Queue_State_Type {
+    Recency_List lists[2];  /* A1in (0) and Am (1), through the lru links of the IPT */
+    int length[2];
+    unsigned char *in_list;  /* Whether each frame is in A1in (0) or Am (1) */
+    Ghost_Set a1out;  /* List 0 only */
+    int kin;  /* The length of A1in above which it gives up its pages */
+    int kout;  /* The number of pages A1out remembers */
+    bool remember_victim;  /* Whether the victim goes to A1out */
+} Two_Queue_State;
+
+static int Two_Queue_Create(Simulator *sim) {
+    Two_Queue_State *two_queue = (Two_Queue_State *)calloc(1, sizeof(Two_Queue_State));
+    sim->policy_state = two_queue;
+    if (two_queue == NULL)
+        return Simulator_Fail(sim, "An error occured during memory allocation");
+    for (int list = 0; list < 2; list++) {
+        two_queue->lists[list].head = two_queue->lists[list].tail = INVALID;
+    }
+    int c = sim->config.num_of_frames;
+    two_queue->kin = (c / 4 > 1) ? c / 4 : 1;
+    two_queue->kout = (c / 2 > 1) ? c / 2 : 1;
+    two_queue->in_list = (unsigned char *)calloc(c, 1);
+    if (two_queue->in_list == NULL || !Ghost_Set_Create(&two_queue->a1out, two_queue->kout + 1))
+        return Simulator_Fail(sim, "An error occured during memory allocation");
+    return OK;
+}
+
+static void Two_Queue_Destroy(Simulator *sim) {
+    Two_Queue_State *two_queue = (Two_Queue_State *)sim->policy_state;
+    if (two_queue != NULL) {
+        free(two_queue->in_list);
+        Ghost_Set_Destroy(&two_queue->a1out);
+    }
+    free(two_queue);
+}
+
+static void Two_Queue_On_Hit(Simulator *sim, int pid, int frame) {
+    (void)pid;
+    Two_Queue_State *two_queue = (Two_Queue_State *)sim->policy_state;
+    if (two_queue->in_list[frame] == 1)
+        LRU_Move_To_Front(&sim->IPT, &two_queue->lists[1], frame);  /* A1in is FIFO, so only hits in Am count */
+}
+
+static void Two_Queue_On_Fill(Simulator *sim, int pid, int frame) {
+    Two_Queue_State *two_queue = (Two_Queue_State *)sim->policy_state;
+    int node = Ghost_Find(&two_queue->a1out, pid, sim->IPT.page_nums[frame]);
+    int list = 0;
+    if (node != INVALID) {  /* Referenced again after it left A1in, so it is a hot page */
+        Ghost_Remove(&two_queue->a1out, node);
+        list = 1;
+    }
+    LRU_Push_Front(&sim->IPT, &two_queue->lists[list], frame);
+    two_queue->length[list]++;
+    two_queue->in_list[frame] = list;
+}
+
+static int Two_Queue_Choose_Victim(Simulator *sim, int pid, uint64_t page_num, bool show) {
+    (void)pid, (void)page_num, (void)show;
+    Two_Queue_State *two_queue = (Two_Queue_State *)sim->policy_state;
+    two_queue->remember_victim = (two_queue->length[0] > two_queue->kin || two_queue->length[1] == 0);
+    return two_queue->lists[two_queue->remember_victim ? 0 : 1].tail;
+}
+
+static void Two_Queue_On_Evict(Simulator *sim, int frame) {
+    Two_Queue_State *two_queue = (Two_Queue_State *)sim->policy_state;
+    int list = two_queue->in_list[frame];
+    LRU_Remove(&sim->IPT, &two_queue->lists[list], frame);
+    two_queue->length[list]--;
+    if (two_queue->remember_victim) {
+        Ghost_Push_Front(&two_queue->a1out, 0, sim->IPT.pids[frame], sim->IPT.page_nums[frame]);
+        if (two_queue->a1out.length[0] > two_queue->kout)
+            Ghost_Remove_Oldest(&two_queue->a1out, 0);
+    }
+}
+
+static int Two_Queue_Save(Simulator *sim, FILE *file) {  /* kin and kout follow from the number of frames, remember_victim only matters during an eviction */
+    Two_Queue_State *two_queue = (Two_Queue_State *)sim->policy_state;
+    bool written = Checkpoint_Write(file, two_queue->lists, sizeof(two_queue->lists)) && Checkpoint_Write(file, two_queue->length, sizeof(two_queue->length))
+        && Checkpoint_Write(file, two_queue->in_list, sim->config.num_of_frames);
+    return (written && Ghost_Set_Save(&two_queue->a1out, file)) ? OK : ERROR;
+}
+
+static int Two_Queue_Load(Simulator *sim, FILE *file) {
+    Two_Queue_State *two_queue = (Two_Queue_State *)sim->policy_state;
+    int num_of_frames = sim->config.num_of_frames;
+    bool read = Recency_List_Load(&two_queue->lists[0], file, num_of_frames) && Recency_List_Load(&two_queue->lists[1], file, num_of_frames)
+        && Checkpoint_Read(file, two_queue->length, sizeof(two_queue->length)) && Checkpoint_Read(file, two_queue->in_list, num_of_frames);
+    return (read && Ghost_Set_Load(&two_queue->a1out, file)) ? OK : ERROR;
+}
+
+/* OPT (Belady): the victim is the page whose next reference is the farthest in the future. The round robin
+   is replayed in advance to find the next use of every reference, and the frames are kept in a max-heap
+   by the next use of their page */
+
+typedef struct OPT_State_Type {
+    int64_t *next_use;  /* The overall number of the next reference to the same page, for every reference (NEVER_USED_AGAIN if there is none) */
+    long long num_of_references;
+    int64_t *frame_next_use;  /* The next use of the page of each frame */
+    int *heap;  /* The loaded frames, the one with the farthest next use on top */
+    int *heap_position;  /* The position of each frame in the heap (INVALID if it is not there) */
+    int heap_size;
+} OPT_State;
+
+static void OPT_Heap_Swap(OPT_State *opt, int i, int j) {
+    int frame = opt->heap[i];
+    opt->heap[i] = opt->heap[j];
+    opt->heap[j] = frame;
+    opt->heap_position[opt->heap[i]] = i;
+    opt->heap_position[opt->heap[j]] = j;
+}
+
+static void OPT_Heap_Update(OPT_State *opt, int frame) {  /* Restore the heap after the next use of a frame changed (or insert the frame) */
+    int i = opt->heap_position[frame];
+    if (i == INVALID) {
+        i = opt->heap_size++;
+        opt->heap[i] = frame;
+        opt->heap_position[frame] = i;
+    }
+    while (i > 0 && opt->frame_next_use[opt->heap[(i - 1) / 2]] < opt->frame_next_use[opt->heap[i]]) {  /* Sift up */
+        OPT_Heap_Swap(opt, i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+    for (;;) {  /* Sift down */
+        int largest = i, left = 2 * i + 1, right = 2 * i + 2;
+        if (left < opt->heap_size && opt->frame_next_use[opt->heap[left]] > opt->frame_next_use[opt->heap[largest]])
+            largest = left;
+        if (right < opt->heap_size && opt->frame_next_use[opt->heap[right]] > opt->frame_next_use[opt->heap[largest]])
+            largest = right;
+        if (largest == i)
+            break;
+        OPT_Heap_Swap(opt, i, largest);
+        i = largest;
+    }
+}
+
+static int OPT_Create(Simulator *sim) {
+    OPT_State *opt = (OPT_State *)calloc(1, sizeof(OPT_State));
+    sim->policy_state = opt;
+    if (opt == NULL)
+        return Simulator_Fail(sim, "An error occured during memory allocation");
+    int num_of_frames = sim->config.num_of_frames;
+    opt->frame_next_use = (int64_t *)malloc(num_of_frames * sizeof(int64_t));
+    opt->heap = (int *)malloc(num_of_frames * sizeof(int));
+    opt->heap_position = (int *)malloc(num_of_frames * sizeof(int));
+    if (opt->frame_next_use == NULL || opt->heap == NULL || opt->heap_position == NULL)
+        return Simulator_Fail(sim, "An error occured during memory allocation");
+    for (int frame = 0; frame < num_of_frames; frame++) {
+        opt->heap_position[frame] = INVALID;
+    }
+    
+    /* Replay the round robin of the same (preloaded) references, without resolving them */
+    Simulator_Config config = sim->config;
+    config.algorithm = ALGORITHM_LRU;
+    config.lru_scan = TRUE;  /* The cheapest policy, it never gets called anyway */
+    config.num_of_frames = 1;
+    config.verbosity = VERBOSITY_SUMMARY;
+    config.events = NULL;
+    Simulator *schedule = (Simulator *)malloc(sizeof(Simulator));
+    long long capacity = 0;
+    for (int pid = 0; pid < sim->num_of_processes; pid++) {
+        capacity += sim->config.preloaded[pid].num_of_references;
+    }
+    if (sim->config.max_num_of_references != INVALID && sim->config.max_num_of_references < capacity)
+        capacity = sim->config.max_num_of_references;
+    uint64_t *page_nums = (uint64_t *)malloc((capacity > 0 ? capacity : 1) * sizeof(uint64_t));  /* The (pid, page_num) of every reference, in the order they get resolved */
+    int *pids = (int *)malloc((capacity > 0 ? capacity : 1) * sizeof(int));
+    opt->next_use = (int64_t *)malloc((capacity > 0 ? capacity : 1) * sizeof(int64_t));
+    int status = (schedule != NULL && page_nums != NULL && pids != NULL && opt->next_use != NULL) ? Simulator_Create(schedule, &config) : ERROR;
+    if (status == OK) {
+        int pid;
+        const Reference *reference;
+        while ((reference = Simulator_Next_Reference(schedule, &pid)) != NULL) {
+            page_nums[schedule->reference_count] = reference->page_num;
+            pids[schedule->reference_count++] = pid;
+        }
+        opt->num_of_references = schedule->reference_count;
+    }
+    if (schedule != NULL)
+        Simulator_Destroy(schedule);
+    free(schedule);
+    
+    /* Walk backwards, remembering the latest (so far) position of each page in a hash map */
+    size_t num_of_cells = 1;  /* The references of the traces are not limited, so the map may need more than 2^31 cells */
+    while (status == OK && num_of_cells < 2 * (size_t)opt->num_of_references)
+        num_of_cells *= 2;
+    int64_t *cell_positions = (status == OK) ? (int64_t *)malloc(num_of_cells * sizeof(int64_t)) : NULL;  /* A cell refers to its page through the position (the page of that reference) */
+    if (cell_positions == NULL)
+        status = ERROR;
+    if (status == OK) {
+        size_t mask = num_of_cells - 1;
+        for (size_t cell = 0; cell < num_of_cells; cell++) {
+            cell_positions[cell] = INVALID;  /* Empty cell */
+        }
+        for (long long i = opt->num_of_references - 1; i >= 0; i--) {
+            size_t cell = Page_Hash(pids[i], page_nums[i]) & mask;
+            while (cell_positions[cell] != INVALID && (page_nums[cell_positions[cell]] != page_nums[i] || pids[cell_positions[cell]] != pids[i]))
+                cell = (cell + 1) & mask;
+            opt->next_use[i] = (cell_positions[cell] != INVALID) ? cell_positions[cell] : NEVER_USED_AGAIN;
+            cell_positions[cell] = i;
+        }
+    }
+    free(cell_positions);
+    free(page_nums);
+    free(pids);
+    if (status != OK)
+        return Simulator_Fail(sim, "An error occured during memory allocation");
+    return OK;
+}
+
+static void OPT_Destroy(Simulator *sim) {
+    OPT_State *opt = (OPT_State *)sim->policy_state;
+    if (opt != NULL) {
+        free(opt->next_use);
+        free(opt->frame_next_use);
+        free(opt->heap);
+        free(opt->heap_position);
+    }
+    free(opt);
+}
+
+static void OPT_On_Reference(Simulator *sim, int pid, int frame) {
+    (void)pid;
+    OPT_State *opt = (OPT_State *)sim->policy_state;
+    long long current = sim->reference_count - 1;  /* The reference being resolved (the count already includes it) */
+    opt->frame_next_use[frame] = (current < opt->num_of_references) ? opt->next_use[current] : NEVER_USED_AGAIN;
+    OPT_Heap_Update(opt, frame);
+}
+
+static int OPT_Choose_Victim(Simulator *sim, int pid, uint64_t page_num, bool show) {
+    (void)pid, (void)page_num, (void)show;
+    return ((OPT_State *)sim->policy_state)->heap[0];  /* It stays in the heap, its next use changes once the new page is loaded */
+}
+
+static int OPT_Save(Simulator *sim, FILE *file) {  /* The next uses of the references are computed again when the policy is created */
+    OPT_State *opt = (OPT_State *)sim->policy_state;
+    bool written = Checkpoint_Write(file, opt->frame_next_use, sim->config.num_of_frames * sizeof(int64_t))
+        && Checkpoint_Write(file, &opt->heap_size, sizeof(int)) && Checkpoint_Write(file, opt->heap, opt->heap_size * sizeof(int));
+    return written ? OK : ERROR;
+}
+
+static int OPT_Load(Simulator *sim, FILE *file) {
+    OPT_State *opt = (OPT_State *)sim->policy_state;
+    int num_of_frames = sim->config.num_of_frames;
+    if (!Checkpoint_Read(file, opt->frame_next_use, num_of_frames * sizeof(int64_t)) || !Checkpoint_Read(file, &opt->heap_size, sizeof(int)) || opt->heap_size < 0 || opt->heap_size > num_of_frames)
+        return ERROR;
+    if (!Checkpoint_Read(file, opt->heap, opt->heap_size * sizeof(int)))
+        return ERROR;
+    for (int i = 0; i < opt->heap_size; i++) {  /* The heap is kept exactly as it was, so ties break the same way */
+        if (opt->heap[i] < 0 || opt->heap[i] >= num_of_frames)
+            return ERROR;
+        opt->heap_position[opt->heap[i]] = i;
+    }
+    return OK;
+}
+
+static const Policy policies[] = {  /* Indexed by Algorithm */
+    {"LRU", FALSE, LRU_Create, LRU_Destroy, LRU_On_Hit, LRU_On_Fill, LRU_Choose_Victim, LRU_On_Evict, LRU_Save, LRU_Load},
+    {"WS", FALSE, WS_Policy_Create, WS_Policy_Destroy, WS_On_Reference, WS_On_Reference, WS_Choose_Victim, Nothing_On_Evict, WS_Save, WS_Load},
+    {"CLOCK", FALSE, Clock_Create, Clock_Destroy, Clock_On_Reference, Clock_On_Reference, Clock_Choose_Victim, Nothing_On_Evict, Clock_Save, Clock_Load},
+    {"ARC", FALSE, ARC_Create, ARC_Destroy, ARC_On_Hit, ARC_On_Fill, ARC_Choose_Victim, ARC_On_Evict, ARC_Save, ARC_Load},
+    {"2Q", FALSE, Two_Queue_Create, Two_Queue_Destroy, Two_Queue_On_Hit, Two_Queue_On_Fill, Two_Queue_Choose_Victim, Two_Queue_On_Evict, Two_Queue_Save, Two_Queue_Load},
+    {"OPT", TRUE, OPT_Create, OPT_Destroy, OPT_On_Reference, OPT_On_Reference, OPT_Choose_Victim, Nothing_On_Evict, OPT_Save, OPT_Load}
+};
+
+static const Policy lru_scan_policy = {"LRU", FALSE, LRU_Scan_Create, LRU_Scan_Destroy, Nothing_On_Hit, Nothing_On_Hit, LRU_Scan_Choose_Victim, Nothing_On_Evict, Nothing_To_Checkpoint, Nothing_To_Checkpoint};  /* The timestamps are kept by the simulator */
+
+const Policy *Policy_Find(Algorithm algorithm, bool lru_scan) {  /* The policy that implements an algorithm */
+    if (algorithm == ALGORITHM_LRU && lru_scan)
+        return &lru_scan_policy;
+    return &policies[algorithm];
+}
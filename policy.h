@@ -0,0 +1,27 @@
+#ifndef POLICY_H
+#define POLICY_H
+
+#include <stdio.h>
+#include "simulator.h"
+
+/* Page replacement policies. The simulator keeps the Inverted Page Table and the free frames and calls its
+   policy on every event: a hit, a page loaded into a frame, the choice of a victim when main memory is full
+   and the eviction of that victim. The policy is looked up once, when the simulator is created. Whatever
+   it keeps besides the IPT (and its lru links) it saves to and loads from checkpoints itself. */
+
+struct Policy_Type {
+    const char *name;
+    bool needs_future;  /* Whether the references have to be known in advance (so the traces get preloaded) */
+    int (*create)(Simulator *sim);  /* Allocate the state of the policy (OK, or ERROR with the reason in sim->error) */
+    void (*destroy)(Simulator *sim);  /* Release that state (even after a failed create) */
+    void (*on_hit)(Simulator *sim, int pid, int frame);  /* The page of this frame was referenced again */
+    void (*on_fill)(Simulator *sim, int pid, int frame);  /* A page was just loaded into this frame (its entry is up to date) */
+    int (*choose_victim)(Simulator *sim, int pid, uint64_t page_num, bool show);  /* The frame to free for the given page when main memory is full (INVALID, with the reason in sim->error, if there is none) */
+    void (*on_evict)(Simulator *sim, int frame);  /* The page of this frame is about to be replaced (its entry is still intact) */
+    int (*save)(Simulator *sim, FILE *file);  /* Write the state of the policy to a checkpoint, between two references (OK or ERROR) */
+    int (*load)(Simulator *sim, FILE *file);  /* Read that state back, after create and after the IPT got restored (OK, or ERROR if it is truncated or corrupt) */
+};
+
+const Policy *Policy_Find(Algorithm algorithm, bool lru_scan);  /* The policy that implements an algorithm */
+
+#endif
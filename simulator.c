@@ -0,0 +1,382 @@
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <sys/mman.h>
+#include "ergasia2.h"
+#include "simulator.h"
+#include "policy.h"
+#include "stream.h"
+
+static void Print_Not_Null_Terminated_String(const char *str, int length) {  /* Used to print not null-terminated strings (relies on given length) */
+    fwrite(str, 1, length, stdout);  /* Print all the characters at once */
+    putchar('\n');
+}
+
+static int Hash_Anchor_Table_Size(int num_of_frames) {  /* Find how many slots the hash anchor table needs (a power of 2, so a mask replaces modulo) */
+    int size = 1;
+    while (size < num_of_frames)  /* At least one slot per frame keeps the chains short (load factor at most 1) */
+        size *= 2;
+    return size;
+}
+
+static unsigned int IPT_Hash(int pid, uint64_t page_num, unsigned int mask) {  /* Map (pid, page_num) to a slot of the hash anchor table */
+    return Page_Hash(pid, page_num) & mask;
+}
+
+static int IPT_Lookup(IPT_Table *IPT, int *hash_anchor_table, unsigned int mask, int pid, uint64_t page_num) {  /* Find the frame that hosts the given page of the given process */
+    for (int frame = hash_anchor_table[IPT_Hash(pid, page_num, mask)]; frame != INVALID; frame = IPT->next[frame]) {  /* Follow the chain of this slot */
+        if (IPT->page_nums[frame] == page_num && IPT->pids[frame] == pid)  /* The page number rarely matches by chance, so the pid is rarely compared in vain */
+            return frame;  /* The requested page is hosted by this frame */
+    }
+    return INVALID;  /* The requested page is not loaded */
+}
+
+static void IPT_Chain_Insert(IPT_Table *IPT, int *hash_anchor_table, unsigned int mask, int frame) {  /* Make the (valid) entry of this frame reachable through the hash anchor table */
+    unsigned int slot = IPT_Hash(IPT->pids[frame], IPT->page_nums[frame], mask);
+    IPT->next[frame] = hash_anchor_table[slot];  /* Put the frame in front of the chain */
+    hash_anchor_table[slot] = frame;
+}
+
+static void IPT_Chain_Remove(IPT_Table *IPT, int *hash_anchor_table, unsigned int mask, int frame) {  /* Unlink this frame from its chain (must be called before its entry changes) */
+    int *link = &hash_anchor_table[IPT_Hash(IPT->pids[frame], IPT->page_nums[frame], mask)];  /* The link that points to the current frame of the chain */
+    while (*link != frame)
+        link = &IPT->next[*link];  /* Proceed to the next link of the chain */
+    *link = IPT->next[frame];  /* Bypass this frame */
+}
+
+const char *Algorithm_Name(Algorithm algorithm) {  /* The name of an algorithm as given in the command line */
+    return Policy_Find(algorithm, FALSE)->name;
+}
+
+int Algorithm_From_Name(const char *name) {  /* The algorithm with this name (INVALID if there is none) */
+    for (int algorithm = 0; algorithm < NUM_OF_ALGORITHMS; algorithm++) {
+        if (strcmp(name, Algorithm_Name((Algorithm)algorithm)) == 0)
+            return algorithm;
+    }
+    return INVALID;
+}
+
+bool Algorithm_Uses_Working_Sets(Algorithm algorithm) {  /* Whether the algorithm needs a ws_size */
+    return (algorithm == ALGORITHM_WS);
+}
+
+int Simulator_Fail(Simulator *sim, const char *format, ...) {  /* Keep the reason why the simulation cannot go on (printf-like) and return ERROR */
+    va_list arguments;
+    va_start(arguments, format);
+    vsnprintf(sim->error, sizeof(sim->error), format, arguments);
+    va_end(arguments);
+    return ERROR;
+}
+
+int Simulator_Lookup(Simulator *sim, int pid, uint64_t page_num) {  /* The frame that hosts the given page of the given process (INVALID if it is not loaded) */
+    return IPT_Lookup(&sim->IPT, sim->hash_anchor_table, sim->hash_mask, pid, page_num);
+}
+
+void Simulator_Rehash(Simulator *sim) {  /* Rebuild the chains of the hash anchor table from the valid entries of the IPT (after they were restored) */
+    for (unsigned int slot = 0; slot <= sim->hash_mask; slot++) {
+        sim->hash_anchor_table[slot] = INVALID;
+    }
+    for (int frame = 0; frame < sim->config.num_of_frames; frame++) {
+        sim->IPT.next[frame] = INVALID;
+        if (Bitmap_Test(sim->IPT.valid, frame))
+            IPT_Chain_Insert(&sim->IPT, sim->hash_anchor_table, sim->hash_mask, frame);
+    }
+}
+
+static void Print_Reference(Simulator *sim, const Reference *reference) {  /* Show a reference as it appears in its trace */
+    if (reference->text != NULL)
+        Print_Not_Null_Terminated_String(reference->text, reference->text_length);  /* The line of the trace is not a proper string so %s identifier would cause undefined behavior */
+    else  /* It came from a binary trace, so rebuild its line */
+        printf("%0*" PRIx64 " %c\n", reference->text_length, (reference->page_num << sim->config.layout.offset_bits) | (uint64_t)reference->offset, reference->action);
+}
+
+void Process_Name(char *name, size_t size, const char *path) {  /* Name a process after its trace (file name without directories and extension) */
+    if (strcmp(path, "-") == 0) {
+        snprintf(name, size, "stdin");
+        return;
+    }
+    size_t length = strlen(path);
+    if (Stream_Is_Command(path)) {  /* Name it after the last word of the command, which is usually the file it reads */
+        length = strrchr(path, '|') - path;
+        while (length > 0 && path[length - 1] == ' ')
+            length--;
+        const char *word = path + length;
+        while (word > path && word[-1] != ' ')
+            word--;
+        length -= word - path;
+        path = word;
+    }
+    const char *base = path;
+    for (size_t i = 0; i < length; i++) {
+        if (path[i] == '/')
+            base = path + i + 1;
+    }
+    length -= base - path;
+    for (int extensions = (Stream_Decompressor(base, length) != NULL) ? 2 : 1; extensions > 0; extensions--) {  /* Drop the extension of the compression aswell as that of the trace */
+        size_t dot = length;
+        while (dot > 0 && base[dot - 1] != '.')
+            dot--;
+        if (dot > 1)  /* A leading dot does not start an extension */
+            length = dot - 1;
+    }
+    if (length >= size)
+        length = size - 1;
+    memcpy(name, base, length);
+    name[length] = '\0';
+}
+
+int Simulator_Create(Simulator *sim, const Simulator_Config *config) {  /* Allocate and initialize a simulation and open its traces (OK, or ERROR with the reason in sim->error) */
+    memset(sim, 0, sizeof(Simulator));  /* Every pointer starts as NULL, so Simulator_Destroy works at any point */
+    sim->config = *config;
+    int num_of_frames = config->num_of_frames;
+    if (num_of_frames < 1 || num_of_frames > MAX_NUM_OF_FRAMES)
+        return Simulator_Fail(sim, "The number of frames must be between 1 and %d", MAX_NUM_OF_FRAMES);
+    if (Algorithm_Uses_Working_Sets(config->algorithm) && (config->ws_size < 1 || config->ws_size > MAX_NUM_OF_FRAMES))
+        return Simulator_Fail(sim, "The working set size must be between 1 and %d", MAX_NUM_OF_FRAMES);
+    
+    /* Reserve space to simulate the main memory (only if its contents are simulated) */
+    if (config->payload == PAYLOAD_LAZY) {
+        sim->main_memory_size = (size_t)num_of_frames << config->layout.offset_bits;  /* A page per frame */
+        void *memory = mmap(NULL, sim->main_memory_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);  /* No swap is reserved and no page is committed before its first write */
+        if (memory == MAP_FAILED)
+            return Simulator_Fail(sim, "Could not reserve %zu bytes for the contents of the frames", sim->main_memory_size);
+        sim->main_memory = (char *)memory;
+    }
+    /* Allocate space for the Inverted Page Table (IPT) */
+    size_t bitmap_words = ((size_t)num_of_frames + 63) / 64;
+    sim->IPT.page_nums = (uint64_t *)malloc((size_t)num_of_frames * sizeof(uint64_t));
+    sim->IPT.pids = (int *)malloc((size_t)num_of_frames * sizeof(int));
+    sim->IPT.timestamps = (long long *)calloc(num_of_frames, sizeof(long long));
+    sim->IPT.valid = (uint64_t *)calloc(bitmap_words, sizeof(uint64_t));  /* Initialy the information in the entries is invalid (trash) */
+    sim->IPT.modified = (uint64_t *)calloc(bitmap_words, sizeof(uint64_t));
+    sim->IPT.next = (int *)malloc((size_t)num_of_frames * sizeof(int));
+    sim->IPT.lru_prev = (int *)malloc((size_t)num_of_frames * sizeof(int));
+    sim->IPT.lru_next = (int *)malloc((size_t)num_of_frames * sizeof(int));
+    /* Allocate space for the hash anchor table, which leads from (pid, page_num) to a chain of frames */
+    int hash_anchor_table_size = Hash_Anchor_Table_Size(num_of_frames);
+    sim->hash_mask = hash_anchor_table_size - 1;
+    sim->hash_anchor_table = (int *)malloc((size_t)hash_anchor_table_size * sizeof(int));
+    /* Allocate space for the list of free frames (used as a stack) */
+    sim->free_frames = (int *)malloc((size_t)num_of_frames * sizeof(int));
+    sim->processes = (Process *)calloc(config->num_of_processes, sizeof(Process));
+    sim->active = (int *)malloc(config->num_of_processes * sizeof(int));
+    if (sim->IPT.page_nums == NULL || sim->IPT.pids == NULL || sim->IPT.timestamps == NULL || sim->IPT.valid == NULL || sim->IPT.modified == NULL || sim->IPT.next == NULL || sim->IPT.lru_prev == NULL || sim->IPT.lru_next == NULL || sim->hash_anchor_table == NULL || sim->free_frames == NULL || sim->processes == NULL || sim->active == NULL) {
+        return Simulator_Fail(sim, "An error occured during memory allocation");
+    }
+    for (int slot = 0; slot < hash_anchor_table_size; slot++) {
+        sim->hash_anchor_table[slot] = INVALID;  /* Initially every chain is empty */
+    }
+    for (int frame = num_of_frames - 1; frame >= 0; frame--) {
+        sim->free_frames[sim->num_of_free_frames++] = frame;  /* Push in reverse order, so the frames are handed out from the lowest to the highest */
+    }
+    /* Initialize the IPT's entries */
+    for (int frame = 0; frame < num_of_frames; frame++) {
+        sim->IPT.next[frame] = INVALID;  /* Not part of any chain */
+        sim->IPT.lru_prev[frame] = sim->IPT.lru_next[frame] = INVALID;  /* Nor of any list (policies that use no list leave them so) */
+    }
+    
+    sim->policy = Policy_Find(config->algorithm, config->lru_scan);  /* Decide once which policy serves the events */
+    if (sim->policy->needs_future && config->preloaded == NULL) {  /* Its references have to be known in advance, so parse the traces now */
+        sim->own_traces = (Trace_Data *)calloc(config->num_of_processes, sizeof(Trace_Data));
+        if (sim->own_traces == NULL)
+            return Simulator_Fail(sim, "An error occured during memory allocation");
+        for (int pid = 0; pid < config->num_of_processes; pid++) {
+            if (Trace_Load(&sim->own_traces[pid], config->trace_paths[pid], &config->layout) != OK)
+                return Simulator_Fail(sim, "Could not open file %s", config->trace_paths[pid]);
+        }
+        sim->config.preloaded = sim->own_traces;
+    }
+    
+    sim->num_of_processes = config->num_of_processes;
+    for (int pid = 0; pid < sim->num_of_processes; pid++) {
+        Process *process = &sim->processes[pid];
+        Process_Name(process->name, sizeof(process->name), config->trace_paths[pid]);
+        if (sim->config.preloaded != NULL) {  /* The trace has already been parsed (and is shared with other simulations) */
+            process->preloaded = sim->config.preloaded[pid].references;
+            process->num_of_preloaded = sim->config.preloaded[pid].num_of_references;
+        }
+        else {
+            process->reader = (Trace_Reader *)malloc(sizeof(Trace_Reader));
+            if (process->reader == NULL)
+                return Simulator_Fail(sim, "An error occured during memory allocation");
+            if (Trace_Open(process->reader, config->trace_paths[pid], &config->layout) != OK) {
+                free(process->reader);
+                process->reader = NULL;
+                return Simulator_Fail(sim, "Could not open file %s", config->trace_paths[pid]);
+            }
+        }
+        sim->active[sim->num_of_active++] = pid;  /* Every process starts in the round robin */
+    }
+    return sim->policy->create(sim);
+}
+
+void Simulator_Destroy(Simulator *sim) {  /* Release everything that belongs to a simulation */
+    for (int pid = 0; sim->processes != NULL && pid < sim->num_of_processes; pid++) {
+        Process *process = &sim->processes[pid];
+        if (process->reader != NULL) {
+            Trace_Close(process->reader);  /* Close its trace */
+            free(process->reader);
+        }
+    }
+    if (sim->policy != NULL)
+        sim->policy->destroy(sim);  /* Before the processes, which may hold part of its state */
+    for (int pid = 0; sim->own_traces != NULL && pid < sim->num_of_processes; pid++) {
+        Trace_Unload(&sim->own_traces[pid]);
+    }
+    free(sim->own_traces);
+    free(sim->processes);
+    free(sim->active);
+    free(sim->free_frames);
+    free(sim->hash_anchor_table);
+    free(sim->IPT.page_nums);
+    free(sim->IPT.pids);
+    free(sim->IPT.timestamps);
+    free(sim->IPT.valid);
+    free(sim->IPT.modified);
+    free(sim->IPT.next);
+    free(sim->IPT.lru_prev);
+    free(sim->IPT.lru_next);
+    if (sim->main_memory != NULL)
+        munmap(sim->main_memory, sim->main_memory_size);
+}
+
+int Simulator_Resolve_Reference(Simulator *sim, int pid, const Reference *reference) {  /* Serve a reference of a process (OK, or ERROR with the reason in sim->error) */
+    IPT_Table *IPT = &sim->IPT;
+    Process *process = &sim->processes[pid];
+    Event_Log *events = sim->config.events;
+    METRICS_HOOK(sim->metrics, Metrics_Begin_Reference(sim->metrics, sim->reference_count));
+    process->references++;  /* Resolving one more reference of this process */
+    long long reference_count = ++sim->reference_count;  /* Therefore resolving one more reference overall */
+    bool show = (sim->config.verbosity == VERBOSITY_FULL || (sim->config.verbosity == VERBOSITY_SAMPLED && reference_count % sim->config.sample_interval == 0));  /* Whether the events of this reference are shown */
+    if (show) {
+        printf("Reference %lld of %s (%lld overall): ", process->references, process->name, reference_count);
+        Print_Reference(sim, reference);
+    }
+    METRICS_HOOK(sim->metrics, Metrics_Section_Begin(sim->metrics, METRICS_LOOKUP));
+    int frame_pos = IPT_Lookup(IPT, sim->hash_anchor_table, sim->hash_mask, pid, reference->page_num);  /* This will show which frame hosts the requested page (INVALID if it is not loaded) */
+    METRICS_HOOK(sim->metrics, Metrics_Section_End(sim->metrics, METRICS_LOOKUP));
+    bool page_fault = (frame_pos == INVALID);
+    if (page_fault) {  /* The requested page was not found in any frame, so we need to find a frame to load it */
+        process->page_faults++;  /* That means a page fault occured due to this reference */
+        if (sim->num_of_free_frames > 0) {  /* If an empty frame is available, load the page there */
+            frame_pos = sim->free_frames[--sim->num_of_free_frames];  /* Take the next free frame */
+            Bitmap_Set(IPT->valid, frame_pos);
+        }
+        else {  /* There wasn't any available frame (main memory is full) so page replacement required */
+            METRICS_HOOK(sim->metrics, Metrics_Section_Begin(sim->metrics, METRICS_VICTIM));
+            frame_pos = sim->policy->choose_victim(sim, pid, reference->page_num, show);  /* The frame that hosts the page that will be replaced */
+            METRICS_HOOK(sim->metrics, Metrics_Section_End(sim->metrics, METRICS_VICTIM));
+            if (frame_pos == INVALID)
+                return ERROR;  /* The policy found none (sim->error says why) */
+            sim->policy->on_evict(sim, frame_pos);
+            if (Bitmap_Test(IPT->modified, frame_pos)) {  /* If the page that is going to be replaced has been modified, save it to hard disk */
+                if (show)
+                    printf("SAVE page %" PRIu64 " from frame %d of main memory to hard disk\n", IPT->page_nums[frame_pos], frame_pos);
+                if (events != NULL)
+                    Event_Log_Write(events, reference_count, IPT->pids[frame_pos], EVENT_SAVE, IPT->page_nums[frame_pos], frame_pos);
+                sim->save_count++;  /* Increase by 1 the number of saves */
+            }
+            IPT_Chain_Remove(IPT, sim->hash_anchor_table, sim->hash_mask, frame_pos);  /* The replaced page is no longer reachable */
+        }
+        if (show)
+            printf("LOAD page %" PRIu64 " from hard disk to frame %d of main memory\n", reference->page_num, frame_pos);
+        if (events != NULL)
+            Event_Log_Write(events, reference_count, pid, EVENT_LOAD, reference->page_num, frame_pos);
+        sim->load_count++;  /* Increase by 1 the number of loads */
+        /* Update the corresponding IPT's entry */
+        IPT->page_nums[frame_pos] = reference->page_num;
+        IPT->pids[frame_pos] = pid;
+        Bitmap_Clear(IPT->modified, frame_pos);
+        IPT_Chain_Insert(IPT, sim->hash_anchor_table, sim->hash_mask, frame_pos);  /* Make the entry reachable by lookups */
+    }
+    IPT->timestamps[frame_pos] = reference_count;  /* Using reference_count so the timestamps of two consecutive references differ by 1 */
+    if (page_fault)
+        sim->policy->on_fill(sim, pid, frame_pos);
+    else
+        sim->policy->on_hit(sim, pid, frame_pos);
+    switch (reference->action) {
+        case 'R':  /* "Read" */
+            if (show)
+                printf("READ page %" PRIu64 " from frame %d of main memory\n", reference->page_num, frame_pos);
+            if (events != NULL)
+                Event_Log_Write(events, reference_count, pid, EVENT_READ, reference->page_num, frame_pos);
+            break;
+        case 'W':  /* "Write" */
+            if (show)
+                printf("WRITE page %" PRIu64 " to frame %d of main memory\n", reference->page_num, frame_pos);
+            if (events != NULL)
+                Event_Log_Write(events, reference_count, pid, EVENT_WRITE, reference->page_num, frame_pos);
+            Bitmap_Set(IPT->modified, frame_pos);  /* The page has been "written" */
+            if (sim->main_memory != NULL)
+                sim->main_memory[((size_t)frame_pos << sim->config.layout.offset_bits) + reference->offset] = 'W';  /* The specified data (this commits the memory of the frame, if it was the first write) */
+            break;
+        default:
+            return Simulator_Fail(sim, "Invalid reference detected in file %s", process->name);
+    }
+    METRICS_HOOK(sim->metrics, Metrics_End_Reference(sim, pid, page_fault));
+    return OK;
+}
+
+static inline const Reference *Process_Next_Reference(Process *process) {  /* The next reference of a process (NULL at the end of its trace) */
+    if (process->preloaded != NULL)
+        return (process->next_preloaded < process->num_of_preloaded) ? &process->preloaded[process->next_preloaded++] : NULL;
+    return Trace_Next(process->reader);
+}
+
+const Reference *Simulator_Next_Reference(Simulator *sim, int *pid) {  /* Pick the process whose turn it is and take its next reference (NULL when the simulation is over) */
+    long long max_num_of_references = sim->config.max_num_of_references;
+    while (sim->num_of_active > 0) {
+        if (max_num_of_references != INVALID && sim->reference_count >= max_num_of_references)
+            break;  /* Stop if the number of references reached the max */
+        *pid = sim->active[sim->turn];  /* Whose turn it is to continue resolving references */
+        METRICS_HOOK(sim->metrics, Metrics_Parse_Begin(sim->metrics, sim->processes[*pid].reader));
+        const Reference *reference = Process_Next_Reference(&sim->processes[*pid]);  /* Take its next reference, already parsed */
+        METRICS_HOOK(sim->metrics, Metrics_Parse_End(sim->metrics));
+        if (reference == NULL) {  /* There are no more references of this process to resolve, so it leaves the round robin */
+            memmove(&sim->active[sim->turn], &sim->active[sim->turn + 1], (sim->num_of_active - sim->turn - 1) * sizeof(int));
+            sim->num_of_active--;
+            if (sim->turn == sim->num_of_active)
+                sim->turn = 0;  /* It was the last one, so the first one continues */
+            sim->quantum_used = 0;
+            continue;
+        }
+        if (++sim->quantum_used >= sim->config.q) {  /* After q resolved references of one process continue to the next one (a resumed simulation may have a smaller q than it was checkpointed with) */
+            sim->quantum_used = 0;
+            sim->turn = (sim->turn + 1) % sim->num_of_active;
+        }
+        return reference;
+    }
+    return NULL;
+}
+
+int Simulator_Run(Simulator *sim) {  /* Resolve references in round robin until the traces end or the max is reached (OK or ERROR) */
+    return Simulator_Run_Until(sim, INVALID);
+}
+
+int Simulator_Run_Until(Simulator *sim, long long reference_count) {  /* Like Simulator_Run, but stop as soon as sim->reference_count reaches the given count (INVALID for no such stop) */
+    int pid;
+    const Reference *reference;
+    while ((reference_count == INVALID || sim->reference_count < reference_count) && (reference = Simulator_Next_Reference(sim, &pid)) != NULL) {
+        if (Simulator_Resolve_Reference(sim, pid, reference) != OK)
+            return ERROR;
+    }
+    return OK;
+}
+
+int Simulator_Used_Frames(Simulator *sim) {  /* The number of frames that hosted atleast one page */
+    return sim->config.num_of_frames - sim->num_of_free_frames;  /* Frames never become free again */
+}
+
+void Simulator_Print_Results(Simulator *sim) {  /* Show the Results block */
+    printf("\nResults:\n");
+    printf("LOAD from hard disk to main memory (aka read from HD): %lld pages\n", sim->load_count);
+    printf("SAVE from main memory to hard disk (aka write to HD): %lld pages\n", sim->save_count);
+    for (int pid = 0; pid < sim->num_of_processes; pid++) {
+        printf("%s: %lld page faults, %lld resolved references\n", sim->processes[pid].name, sim->processes[pid].page_faults, sim->processes[pid].references);
+    }
+    printf("During this simulation: %d frames were used of %d available frames\n\n", Simulator_Used_Frames(sim), sim->config.num_of_frames);
+}
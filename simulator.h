@@ -0,0 +1,179 @@
+#ifndef SIMULATOR_H
+#define SIMULATOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "ergasia2.h"
+#include "trace.h"
+#include "events.h"
+#include "metrics.h"
+
+/* The simulated main memory and its Inverted Page Table, shared by any number of processes. Each process
+   replays its own trace and the scheduler resolves q references of each one in turn (round robin). */
+
+#define FRAME_SET_MAX_LEVELS 6  /* 64^6 bits are more than enough for any int number of frames */
+#define OWNER_MIXED -2  /* The frames of a subtree belong to more than one owner */
+#define OWNER_PADDING -3  /* The leaf does not correspond to an actual frame */
+
+#define NO_PAGE UINT64_MAX  /* Stands for no page where a page number is expected (no real page number reaches it, since the offset takes at least one bit) */
+
+static inline uint64_t Page_Hash(int pid, uint64_t page_num) {  /* Mix a page of a process into 64 bits, so equal page numbers of different processes and neighbouring pages spread apart */
+    uint64_t key = page_num ^ ((uint64_t)(uint32_t)pid * 0x9E3779B97F4A7C15ull);
+    key ^= key >> 33;  /* Finalizer of MurmurHash3 */
+    key *= 0xFF51AFD7ED558CCDull;
+    key ^= key >> 33;
+    key *= 0xC4CEB9FE1A85EC53ull;
+    key ^= key >> 33;
+    return key;
+}
+
+typedef struct IPT_Table_Type {  /* The Inverted Page Table: an entry per frame, kept as separate arrays, so a scan pulls into the cache only the field it compares */
+    uint64_t *page_nums;  /* The page number of the hosted page */
+    int *pids;  /* The ID of the process that uses the entry (its index in the processes of the simulator) */
+    long long *timestamps;  /* Indicates the last time (virtual, not actual time) there was a reference to the hosted page */
+    uint64_t *valid;  /* Bitmap: if the bit of an entry is set, the rest information of the entry is reliable. Else it is trash and the entry is actually empty */
+    uint64_t *modified;  /* Bitmap: whether the hosted page has been written since the last time it got loaded from hard disk */
+    int *next;  /* The next frame whose (pid, page_num) falls in the same slot of the hash anchor table (INVALID ends the chain) */
+    int *lru_prev;  /* The frame referenced right after this one in the recency list (INVALID if this is the most recently used). ARC and 2Q use the links for their own lists */
+    int *lru_next;  /* The frame referenced right before this one in the recency list (INVALID if this is the least recently used) */
+} IPT_Table;
+
+static inline bool Bitmap_Test(const uint64_t *bitmap, int bit) {
+    return (bitmap[bit / 64] >> (bit % 64)) & 1;
+}
+
+static inline void Bitmap_Set(uint64_t *bitmap, int bit) {
+    bitmap[bit / 64] |= (uint64_t)1 << (bit % 64);
+}
+
+static inline void Bitmap_Clear(uint64_t *bitmap, int bit) {
+    bitmap[bit / 64] &= ~((uint64_t)1 << (bit % 64));
+}
+
+typedef struct Recency_List_Type {  /* Doubly linked list of the loaded frames, ordered from the most to the least recently used */
+    int head;  /* The most recently used frame (INVALID if the list is empty) */
+    int tail;  /* The least recently used frame, which is the LRU victim (INVALID if the list is empty) */
+} Recency_List;
+
+typedef struct Working_Set_Type {  /* The pages of the last ws_size references of a process */
+    uint64_t *window;  /* Ring buffer with the page of each of the last ws_size references (NO_PAGE for a slot that is empty or released) */
+    int size;  /* The number of slots of the window (ws_size) */
+    int oldest;  /* The slot of the oldest reference, which the next insertion overwrites */
+    uint64_t *pages;  /* Hash map (open addressing) from a page to the number of slots that hold it. NO_PAGE marks an empty cell */
+    int *counts;  /* The number of slots of the window that hold the page of the same cell (always at least 1) */
+    unsigned int mask;  /* The number of cells of the hash map minus 1 (the number of cells is a power of 2) */
+} Working_Set;
+
+typedef struct Frame_Set_Type {  /* Set of frames that can report its lowest member fast (hierarchical bitmap) */
+    uint64_t *levels[FRAME_SET_MAX_LEVELS];  /* levels[0] has a bit per frame, levels[i] has a bit per non-empty word of levels[i - 1] */
+    int num_of_levels;  /* The top level consists of a single word */
+} Frame_Set;
+
+typedef struct Owner_Tree_Type {  /* Segment tree that reports the lowest frame which is not owned by a given process */
+    int *nodes;  /* nodes[1] is the root, the children of i are 2i and 2i+1. Each node keeps the common owner of its frames (or OWNER_MIXED) */
+    int num_of_leaves;  /* A power of 2, at least equal to the number of frames */
+} Owner_Tree;
+
+typedef enum Algorithm {  /* Page replacement algorithm */
+    ALGORITHM_LRU,
+    ALGORITHM_WS,
+    ALGORITHM_CLOCK,
+    ALGORITHM_ARC,
+    ALGORITHM_2Q,
+    ALGORITHM_OPT,
+    NUM_OF_ALGORITHMS
+} Algorithm;
+
+typedef struct Policy_Type Policy;  /* The replacement logic of an algorithm (see policy.h) */
+
+typedef enum Payload {  /* Whether the contents of the frames are simulated */
+    PAYLOAD_NONE,  /* Only the metadata (IPT), no memory for the frames at all */
+    PAYLOAD_LAZY  /* Address space for every frame is reserved, but memory is only committed when a page gets written */
+} Payload;
+
+typedef enum Verbosity {  /* How much of the simulation is shown */
+    VERBOSITY_FULL,  /* Every event of every reference */
+    VERBOSITY_SAMPLED,  /* The events of every sample_interval-th reference */
+    VERBOSITY_SUMMARY  /* Only the results */
+} Verbosity;
+
+typedef struct Simulator_Config_Type {  /* Everything that defines a simulation */
+    Algorithm algorithm;
+    bool lru_scan;  /* Find the LRU victim by scanning the timestamps instead of taking the tail of the recency list */
+    int num_of_frames;  /* The number of available frames in main memory */
+    int q;  /* After q resolved references of one process continue to the next one */
+    int ws_size;  /* This determines how many pages each working set can carry simultaneously (WS only) */
+    long long max_num_of_references;  /* After resolving this number of references (in total) the simulation ends (INVALID for no limit) */
+    Address_Layout layout;  /* The page size and the width of the logical addresses (with every shift and mask derived once) */
+    const char **trace_paths;  /* The trace of each process */
+    int num_of_processes;
+    Verbosity verbosity;
+    int sample_interval;  /* With VERBOSITY_SAMPLED, show the references whose overall number is a multiple of this */
+    Event_Log *events;  /* Where to write the event stream (NULL for no stream) */
+    Payload payload;
+    const Trace_Data *preloaded;  /* If not NULL, the already parsed references of each process (read only, so simulations can share them) */
+} Simulator_Config;
+
+typedef struct Process_Type {  /* Descriptor of a simulated process */
+    char name[64];  /* Its trace's file name without directories and extension (e.g. "bzip" for "traces/bzip.trace") */
+    Trace_Reader *reader;  /* Its trace (NULL if its references were preloaded) */
+    const Reference *preloaded;  /* Its references, if they were preloaded */
+    long long num_of_preloaded;
+    long long next_preloaded;  /* The position in preloaded of its next reference */
+    Working_Set working_set;  /* Its working set (WS only) */
+    long long page_faults;  /* Count how many references of this process led to page fault */
+    long long references;  /* Count how many references of this process have been resolved so far */
+} Process;
+
+typedef struct Simulator_Type {  /* The whole state of a simulation */
+    Simulator_Config config;
+    char *main_memory;  /* The simulated main memory, a page after the other (NULL with PAYLOAD_NONE) */
+    size_t main_memory_size;  /* Its size in bytes */
+    IPT_Table IPT;  /* The Inverted Page Table (a entry per frame) */
+    int *hash_anchor_table;  /* Leads from (pid, page_num) to a chain of frames */
+    unsigned int hash_mask;  /* The number of slots of the hash anchor table minus 1 */
+    int *free_frames;  /* Frames that have never been used (a stack, the lowest on top) */
+    int num_of_free_frames;
+    const Policy *policy;  /* Decides which page gets replaced (looked up once, from the algorithm) */
+    void *policy_state;  /* The state of policies that keep it outside the fields below */
+    Recency_List recency_list;  /* LRU (without --lru-scan) */
+    Frame_Set frames_outside_ws;  /* The loaded frames whose page does not belong to the working set of its process (candidate victims) */
+    Owner_Tree owners;  /* Which process owns each frame, to find whose working set has to be disturbed */
+    Process *processes;
+    int num_of_processes;
+    Trace_Data *own_traces;  /* Traces the simulator preloaded itself, for a policy that needs the future (NULL if none) */
+    int *active;  /* The processes that still have references to resolve, in round robin order */
+    int num_of_active;
+    int turn;  /* The position in active of the process whose turn it is */
+    int quantum_used;  /* How many of its q references that process has already resolved in this turn */
+    long long reference_count;  /* Count the currently resolved references (all processes included) */
+    long long load_count;  /* Count how many times it was necessary to load page from hard disk to main memory */
+    long long save_count;  /* Count how many times it was necessary to save page from main memory to hard disk */
+    char error[160];  /* Why the simulation could not go on (after a function returned ERROR) */
+#ifdef ENABLE_METRICS
+    Metrics *metrics;  /* The time series being collected (NULL if none, e.g. for the simulations of a sweep) */
+#endif
+} Simulator;
+
+/* A simulation keeps all of its state in its Simulator, so any number of them can run side by side (in different
+   threads), as long as they write no events and show nothing (VERBOSITY_SUMMARY). On ERROR, sim->error says why. */
+
+const char *Algorithm_Name(Algorithm algorithm);  /* The name of an algorithm as given in the command line */
+int Algorithm_From_Name(const char *name);  /* The algorithm with this name (INVALID if there is none) */
+bool Algorithm_Uses_Working_Sets(Algorithm algorithm);  /* Whether the algorithm needs a ws_size */
+void Process_Name(char *name, size_t size, const char *path);  /* Name a process after its trace (file name without directories and extension) */
+
+int Simulator_Fail(Simulator *sim, const char *format, ...);  /* Keep the reason why the simulation cannot go on (printf-like) and return ERROR */
+int Simulator_Lookup(Simulator *sim, int pid, uint64_t page_num);  /* The frame that hosts the given page of the given process (INVALID if it is not loaded) */
+void Simulator_Rehash(Simulator *sim);  /* Rebuild the chains of the hash anchor table from the valid entries of the IPT (after they were restored) */
+int Simulator_Create(Simulator *sim, const Simulator_Config *config);  /* Allocate and initialize a simulation and open its traces (OK or ERROR) */
+void Simulator_Destroy(Simulator *sim);  /* Release everything that belongs to a simulation */
+int Simulator_Resolve_Reference(Simulator *sim, int pid, const Reference *reference);  /* Serve a reference of a process (OK or ERROR) */
+const Reference *Simulator_Next_Reference(Simulator *sim, int *pid);  /* Advance the round robin: the next reference and its process (NULL when the traces end or sim->reference_count reached the max) */
+int Simulator_Run(Simulator *sim);  /* Resolve references in round robin until the traces end or the max is reached (OK or ERROR) */
+int Simulator_Run_Until(Simulator *sim, long long reference_count);  /* Like Simulator_Run, but stop as soon as sim->reference_count reaches the given count (INVALID for no such stop) */
+int Simulator_Used_Frames(Simulator *sim);  /* The number of frames that hosted atleast one page */
+void Simulator_Print_Results(Simulator *sim);  /* Show the Results block */
+
+#endif
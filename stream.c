@@ -0,0 +1,263 @@
+#define _GNU_SOURCE  /* pipe2 */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include "ergasia2.h"
+#include "stream.h"
+
+extern char **environ;
+
+static const struct {
+    const char *extension;
+    const char *decompressor;  /* Run as "<decompressor> -dc <file>" */
+} compressed_formats[] = {
+    { ".gz", "gzip" },
+    { ".zst", "zstd" },
+    { ".xz", "xz" },
+    { ".bz2", "bzip2" }
+};
+
+const char *Stream_Decompressor(const char *path, size_t length) {  /* The decompressor for the extension of the first length characters of path (NULL if it is not a compressed file) */
+    for (size_t i = 0; i < sizeof(compressed_formats) / sizeof(compressed_formats[0]); i++) {
+        size_t extension_length = strlen(compressed_formats[i].extension);
+        if (length > extension_length && memcmp(path + length - extension_length, compressed_formats[i].extension, extension_length) == 0)
+            return compressed_formats[i].decompressor;
+    }
+    return NULL;
+}
+
+bool Stream_Is_Command(const char *path) {  /* Whether the trace is the output of a command ("<command> |") */
+    size_t length = strlen(path);
+    while (length > 0 && path[length - 1] == ' ')
+        length--;
+    return (length > 1 && path[length - 1] == '|');
+}
+
+bool Stream_Wanted(const char *path) {  /* Whether the trace can only be read through a pipe (standard input, command or compressed file) */
+    return (strcmp(path, "-") == 0 || Stream_Is_Command(path) || Stream_Decompressor(path, strlen(path)) != NULL);
+}
+
+static int Stream_Spawn(const char *path, pid_t *child) {  /* Start the decompressor or the command of a trace and return the read end of its output (INVALID on error) */
+    char *command = NULL;
+    char *arguments[4];
+    if (Stream_Is_Command(path)) {
+        command = strndup(path, strrchr(path, '|') - path);  /* Without the trailing '|' */
+        arguments[0] = "sh", arguments[1] = "-c", arguments[2] = command;
+    }
+    else {
+        if (access(path, R_OK) != 0)
+            return INVALID;  /* Fail now, rather than with an empty trace */
+        arguments[0] = (char *)Stream_Decompressor(path, strlen(path)), arguments[1] = "-dc", arguments[2] = (char *)path;
+    }
+    arguments[3] = NULL;
+    int ends[2];
+    if (arguments[2] == NULL || pipe2(ends, O_CLOEXEC) != 0) {  /* Close on exec, so no other child keeps the pipe open */
+        free(command);
+        return INVALID;
+    }
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, ends[1], STDOUT_FILENO);  /* The copy is inherited, unlike the original */
+    int status = posix_spawnp(child, arguments[0], &actions, NULL, arguments, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    close(ends[1]);  /* Only the child writes */
+    free(command);
+    if (status != 0) {
+        close(ends[0]);
+        *child = 0;
+        return INVALID;
+    }
+    return ends[0];
+}
+
+static inline void Stream_Relax(void) {  /* Let the other hyperthread run while spinning */
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+static bool Stream_Has_Room(Trace_Stream *stream) {  /* The thread may fill a slot (or has to stop) */
+    return (atomic_load(&stream->head) - atomic_load(&stream->tail) < STREAM_RING_SIZE || atomic_load(&stream->stop));
+}
+
+static bool Stream_Has_Batch(Trace_Stream *stream) {  /* The simulation may use a slot */
+    return (atomic_load(&stream->head) != atomic_load(&stream->tail));
+}
+
+static void Stream_Wait(Trace_Stream *stream, bool (*ready)(Trace_Stream *stream)) {  /* Wait until the other side makes the condition true */
+    for (int spin = 0; spin < STREAM_SPINS; spin++) {
+        if (ready(stream))
+            return;
+        Stream_Relax();
+    }
+    pthread_mutex_lock(&stream->lock);
+    atomic_fetch_add(&stream->sleepers, 1);  /* Announced before the last check, so the other side either sees it or changed the condition already */
+    while (!ready(stream))
+        pthread_cond_wait(&stream->wake, &stream->lock);
+    atomic_fetch_sub(&stream->sleepers, 1);
+    pthread_mutex_unlock(&stream->lock);
+}
+
+static void Stream_Signal(Trace_Stream *stream) {  /* An index has just advanced, so wake the other side if it sleeps */
+    if (atomic_load(&stream->sleepers) > 0) {
+        pthread_mutex_lock(&stream->lock);
+        pthread_cond_broadcast(&stream->wake);
+        pthread_mutex_unlock(&stream->lock);
+    }
+}
+
+static void Stream_Keep_Text(Stream_Batch *slot) {  /* Copy the text of the references into the slot, since the chunk it points to gets overwritten */
+    size_t size = 0;
+    for (int i = 0; i < slot->length; i++) {
+        if (slot->references[i].text != NULL)
+            size += slot->references[i].text_length;
+    }
+    if (size > slot->text_capacity) {
+        char *larger = (char *)realloc(slot->text, size);
+        if (larger != NULL) {
+            slot->text = larger;
+            slot->text_capacity = size;
+        }
+    }
+    char *text = slot->text;
+    for (int i = 0; i < slot->length; i++) {
+        Reference *reference = &slot->references[i];
+        if (reference->text == NULL)
+            continue;
+        if (size > slot->text_capacity) {  /* Out of memory: keep just the width of the address, like a trace that is loaded whole */
+            int num_of_digits = 0;
+            while (num_of_digits < reference->text_length && isxdigit((unsigned char)reference->text[num_of_digits]))
+                num_of_digits++;
+            reference->text = NULL;
+            reference->text_length = num_of_digits;
+            continue;
+        }
+        memcpy(text, reference->text, reference->text_length);
+        reference->text = text;
+        text += reference->text_length;
+    }
+}
+
+static void *Stream_Reader_Thread(void *argument) {  /* Fill the slots of the ring with batches, until the end of the trace */
+    Trace_Stream *stream = (Trace_Stream *)argument;
+    for (;;) {
+        Stream_Wait(stream, Stream_Has_Room);
+        if (atomic_load(&stream->stop))
+            break;
+        unsigned int head = atomic_load_explicit(&stream->head, memory_order_relaxed);  /* Only this thread changes it */
+        Stream_Batch *slot = &stream->slots[head % STREAM_RING_SIZE];
+        slot->length = Trace_Read_Batch(stream->source, slot->references, TRACE_BATCH_SIZE);
+        Stream_Keep_Text(slot);
+        atomic_store(&stream->head, head + 1);  /* Publish the slot (the simulation sees its contents along with the new head) */
+        Stream_Signal(stream);
+        if (slot->length == 0)
+            break;  /* The empty batch marks the end */
+    }
+    return NULL;
+}
+
+int Stream_Open(Trace_Reader *reader, const char *path, int fd) {  /* Start the reader thread of a trace (OK or ERROR) */
+    Trace_Stream *stream = (Trace_Stream *)calloc(1, sizeof(Trace_Stream));
+    if (stream == NULL) {
+        if (fd != INVALID)
+            close(fd);
+        return ERROR;
+    }
+    if (fd == INVALID)
+        fd = (strcmp(path, "-") == 0) ? dup(STDIN_FILENO) : Stream_Spawn(path, &stream->child);  /* A copy of the standard input, so closing the trace leaves it open */
+    stream->source = (fd >= 0) ? (Trace_Reader *)malloc(sizeof(Trace_Reader)) : NULL;
+    if (stream->source == NULL || Trace_Open_Descriptor(stream->source, fd, &reader->layout) != OK) {  /* The source takes fd over (and closes it on ERROR) */
+        if (stream->source == NULL && fd >= 0)
+            close(fd);
+        if (stream->child > 0) {
+            kill(stream->child, SIGTERM);
+            waitpid(stream->child, NULL, 0);
+        }
+        free(stream->source);
+        free(stream);
+        return ERROR;
+    }
+    atomic_init(&stream->head, 0);
+    atomic_init(&stream->tail, 0);
+    atomic_init(&stream->stop, FALSE);
+    atomic_init(&stream->sleepers, 0);
+    pthread_mutex_init(&stream->lock, NULL);
+    pthread_cond_init(&stream->wake, NULL);
+    stream->wake_pipe[0] = stream->wake_pipe[1] = INVALID;
+    if (pipe2(stream->wake_pipe, O_CLOEXEC) == 0)
+        stream->source->wake_fd = stream->wake_pipe[0];
+    if (stream->source->wake_fd == INVALID || pthread_create(&stream->thread, NULL, Stream_Reader_Thread, stream) != 0) {
+        Trace_Close(stream->source);
+        if (stream->wake_pipe[0] != INVALID) {
+            close(stream->wake_pipe[0]);
+            close(stream->wake_pipe[1]);
+        }
+        free(stream->source);
+        if (stream->child > 0) {
+            kill(stream->child, SIGTERM);
+            waitpid(stream->child, NULL, 0);
+        }
+        pthread_mutex_destroy(&stream->lock);
+        pthread_cond_destroy(&stream->wake);
+        free(stream);
+        return ERROR;
+    }
+    reader->stream = stream;
+    reader->fd = INVALID;  /* The source owns the descriptor */
+    return OK;
+}
+
+int Stream_Read_Batch(Trace_Stream *stream, Reference *batch, int max_length) {  /* Hand out up to max_length references of the oldest filled slot (0 at the end of the trace) */
+    if (stream->finished)
+        return 0;
+    unsigned int tail = atomic_load_explicit(&stream->tail, memory_order_relaxed);  /* Only the simulation changes it */
+    if (stream->next > 0 && stream->next == stream->slots[tail % STREAM_RING_SIZE].length) {  /* The oldest slot is used up, so give it back to the thread */
+        atomic_store(&stream->tail, ++tail);
+        stream->next = 0;
+        Stream_Signal(stream);
+    }
+    if (!Stream_Has_Batch(stream))
+        Stream_Wait(stream, Stream_Has_Batch);
+    Stream_Batch *slot = &stream->slots[tail % STREAM_RING_SIZE];
+    if (slot->length == 0) {
+        stream->finished = TRUE;
+        return 0;
+    }
+    int length = slot->length - stream->next;
+    if (length > max_length)
+        length = max_length;
+    memcpy(batch, &slot->references[stream->next], length * sizeof(Reference));  /* The text stays in the slot, which is not given back before the next call */
+    stream->next += length;
+    return length;
+}
+
+void Stream_Close(Trace_Stream *stream) {  /* Stop the reader thread (and the decompressor or command) and release everything */
+    if (!stream->finished) {  /* The simulation ended before the trace: the thread may sleep or wait for its input */
+        atomic_store(&stream->stop, TRUE);
+        Stream_Signal(stream);  /* Out of a full ring */
+        ssize_t written = write(stream->wake_pipe[1], "", 1);  /* Out of poll(), while it waits for input (a byte always fits in the empty pipe) */
+        (void)written;
+    }
+    pthread_join(stream->thread, NULL);
+    close(stream->wake_pipe[0]);
+    close(stream->wake_pipe[1]);
+    Trace_Close(stream->source);  /* Closes the pipe, so a writer that is still running gets SIGPIPE */
+    free(stream->source);
+    if (stream->child > 0) {
+        if (!stream->finished)
+            kill(stream->child, SIGTERM);  /* It may be waiting on its own input */
+        waitpid(stream->child, NULL, 0);
+    }
+    for (int slot = 0; slot < STREAM_RING_SIZE; slot++) {
+        free(stream->slots[slot].text);
+    }
+    pthread_mutex_destroy(&stream->lock);
+    pthread_cond_destroy(&stream->wake);
+    free(stream);
+}
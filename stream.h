@@ -0,0 +1,54 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include "trace.h"
+
+/* Traces that cannot be mapped to memory: the standard input ("-"), named pipes, compressed files (".gz",
+   ".zst", ".xz" and ".bz2", through their decompressor) and the output of a command ("<command> |").
+   A reader thread per trace parses it and hands the batches of references to the simulation through a
+   ring of STREAM_RING_SIZE slots, so parsing (and decompression) overlaps with the simulation and the
+   memory of a trace stays the same however long it is. Each slot owns a copy of the text of its
+   references, so they stay valid after the thread moves on to the next chunk of the input.
+
+   The ring is lock-free: the thread only advances head and the simulation only advances tail. Either
+   side spins for a while when it has to wait for the other, and only then goes to sleep. The thread is
+   never cancelled: closing the trace early sets stop and writes to the wake pipe, which the thread watches
+   along with its input. */
+
+#define STREAM_RING_SIZE 16  /* The number of batches that can be parsed ahead of the simulation */
+#define STREAM_SPINS 4096  /* How many times a side checks the ring before it sleeps */
+
+typedef struct Stream_Batch_Type {  /* A slot of the ring */
+    Reference references[TRACE_BATCH_SIZE];
+    int length;  /* The number of references (0 marks the end of the trace) */
+    char *text;  /* The text of the references, one after the other */
+    size_t text_capacity;
+} Stream_Batch;
+
+typedef struct Trace_Stream_Type {  /* The reader thread of a trace and its ring */
+    Trace_Reader *source;  /* The input, parsed by the thread */
+    pid_t child;  /* The decompressor or command that writes the input (0 if there is none) */
+    pthread_t thread;
+    Stream_Batch slots[STREAM_RING_SIZE];
+    atomic_uint head;  /* The number of batches the thread has filled */
+    atomic_uint tail;  /* The number of batches the simulation has used up */
+    atomic_bool stop;  /* The simulation closed the trace before its end */
+    int wake_pipe[2];  /* A pipe the simulation writes to when it closes the trace early, so a thread that waits for input returns */
+    atomic_int sleepers;  /* How many sides sleep on wake (only then does the other side take the lock) */
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    int next;  /* The next reference of the oldest filled slot to hand out */
+    bool finished;  /* The slot that marks the end has been reached */
+} Trace_Stream;
+
+const char *Stream_Decompressor(const char *path, size_t length);  /* The decompressor for the extension of the first length characters of path (NULL if it is not a compressed file) */
+bool Stream_Is_Command(const char *path);  /* Whether the trace is the output of a command ("<command> |") */
+bool Stream_Wanted(const char *path);  /* Whether the trace can only be read through a pipe (standard input, command or compressed file) */
+int Stream_Open(Trace_Reader *reader, const char *path, int fd);  /* Start the reader thread of a trace: fd if it is open already (INVALID otherwise, to open the source named by path). OK or ERROR */
+int Stream_Read_Batch(Trace_Stream *stream, Reference *batch, int max_length);  /* Hand out up to max_length references of the oldest filled slot (0 at the end of the trace). They stay valid until the next call */
+void Stream_Close(Trace_Stream *stream);  /* Stop the reader thread (and the decompressor or command) and release everything */
+
+#endif
@@ -0,0 +1,326 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "ergasia2.h"
+#include "sweep.h"
+
+typedef struct Sweep_Job_Type {  /* One configuration of the grid and its outcome */
+    Algorithm algorithm;
+    int num_of_frames;
+    int q;
+    int ws_size;  /* INVALID for algorithms without working sets */
+    int status;  /* OK or ERROR */
+    char error[160];
+    long long load_count;
+    long long save_count;
+    long long reference_count;
+    int used_frames;
+    long long *page_faults;  /* Per process */
+} Sweep_Job;
+
+typedef struct Work_Queue_Type {  /* The jobs a worker has not started yet (a deque: the owner takes from the back, thieves from the front) */
+    pthread_mutex_t lock;
+    int *jobs;
+    int front;
+    int back;  /* One past the last job */
+} Work_Queue;
+
+typedef struct Sweep_Context_Type {  /* What the workers share */
+    const Sweep_Spec *spec;
+    Trace_Data *traces;  /* Parsed once, read only from then on */
+    Sweep_Job *jobs;
+    Work_Queue *queues;  /* One per worker */
+    int num_of_workers;
+} Sweep_Context;
+
+typedef struct Worker_Type {
+    Sweep_Context *context;
+    int id;
+} Worker;
+
+static bool Sweep_Parse_Value(const char *text, char **end, long *value) {  /* Parse a decimal number that fits in an int (FALSE if there is none or it is out of range) */
+    errno = 0;
+    *value = strtol(text, end, 10);
+    return (*end != text && errno == 0 && *value >= INT_MIN && *value <= INT_MAX);
+}
+
+static int Sweep_Parse_Items(const char *text, int **values, int *count) {  /* Append the values of every item of the list to *values (OK or ERROR) */
+    int capacity = 16;
+    *values = (int *)malloc(capacity * sizeof(int));
+    if (*values == NULL)
+        return ERROR;
+    while (*text != '\0') {
+        char *end;
+        long start, stop, step = 1;
+        if (!Sweep_Parse_Value(text, &end, &start))
+            return ERROR;
+        stop = start;
+        if (*end == ':') {  /* A range */
+            if (!Sweep_Parse_Value(end + 1, &end, &stop))
+                return ERROR;
+            if (*end == ':' && !Sweep_Parse_Value(end + 1, &end, &step))
+                return ERROR;
+            if (step < 1 || stop < start)
+                return ERROR;
+        }
+        if (*end != ',' && *end != '\0')
+            return ERROR;
+        for (long value = start; value <= stop; value += step) {  /* A long, so it cannot wrap past INT_MAX */
+            if (*count == capacity) {
+                if (capacity > INT_MAX / 2)
+                    return ERROR;  /* Far more configurations than could ever be simulated */
+                capacity *= 2;
+                int *larger = (int *)realloc(*values, (size_t)capacity * sizeof(int));
+                if (larger == NULL)
+                    return ERROR;
+                *values = larger;
+            }
+            (*values)[(*count)++] = value;
+        }
+        text = (*end == ',') ? end + 1 : end;
+    }
+    return (*count > 0) ? OK : ERROR;
+}
+
+int Sweep_Parse_List(const char *text, int **values, int *count) {  /* Parse "a,b,c" and/or "start:end:step" items into a new array (OK, or ERROR with *values NULL) */
+    *count = 0;
+    if (Sweep_Parse_Items(text, values, count) == OK)
+        return OK;
+    free(*values);  /* Whatever was parsed before the error */
+    *values = NULL;
+    *count = 0;
+    return ERROR;
+}
+
+static void Sweep_Simulate(Sweep_Context *context, Sweep_Job *job) {  /* Run the simulation of one configuration */
+    const Sweep_Spec *spec = context->spec;
+    Simulator_Config config;
+    memset(&config, 0, sizeof(config));
+    config.algorithm = job->algorithm;
+    config.num_of_frames = job->num_of_frames;
+    config.q = job->q;
+    config.ws_size = job->ws_size;
+    config.max_num_of_references = spec->max_num_of_references;
+    config.layout = spec->layout;
+    config.trace_paths = spec->trace_paths;
+    config.num_of_processes = spec->num_of_processes;
+    config.verbosity = VERBOSITY_SUMMARY;  /* Nothing is shown, so simulations do not disturb each other */
+    config.sample_interval = 1;
+    config.events = NULL;
+    config.preloaded = context->traces;
+    Simulator *sim = (Simulator *)malloc(sizeof(Simulator));
+    if (sim == NULL) {
+        job->status = ERROR;
+        strcpy(job->error, "An error occured during memory allocation");
+        return;
+    }
+    job->status = Simulator_Create(sim, &config);
+    if (job->status == OK)
+        job->status = Simulator_Run(sim);
+    if (job->status == OK) {
+        job->load_count = sim->load_count;
+        job->save_count = sim->save_count;
+        job->reference_count = sim->reference_count;
+        job->used_frames = Simulator_Used_Frames(sim);
+        for (int pid = 0; pid < spec->num_of_processes; pid++) {
+            job->page_faults[pid] = sim->processes[pid].page_faults;
+        }
+    }
+    else
+        strcpy(job->error, sim->error);
+    Simulator_Destroy(sim);
+    free(sim);
+}
+
+static int Work_Queue_Take(Work_Queue *queue, bool from_back) {  /* Remove a job from one end of a queue (INVALID if it is empty) */
+    int job = INVALID;
+    pthread_mutex_lock(&queue->lock);
+    if (queue->front < queue->back)
+        job = from_back ? queue->jobs[--queue->back] : queue->jobs[queue->front++];
+    pthread_mutex_unlock(&queue->lock);
+    return job;
+}
+
+static void *Sweep_Worker(void *argument) {  /* Run jobs until every queue is empty */
+    Worker *worker = (Worker *)argument;
+    Sweep_Context *context = worker->context;
+    for (;;) {
+        int job = Work_Queue_Take(&context->queues[worker->id], TRUE);  /* Own jobs first */
+        for (int i = 1; job == INVALID && i < context->num_of_workers; i++) {  /* Then steal from the others, starting with the next one */
+            job = Work_Queue_Take(&context->queues[(worker->id + i) % context->num_of_workers], FALSE);
+        }
+        if (job == INVALID)
+            return NULL;  /* Nothing is left anywhere (jobs never get added) */
+        Sweep_Simulate(context, &context->jobs[job]);
+    }
+}
+
+static void Sweep_Write_Quoted(FILE *output, const char *text) {  /* Write a CSV field that may contain commas or quotes (each quote is doubled) */
+    fputc('"', output);
+    for (const char *c = text; *c != '\0'; c++) {
+        if (*c == '"')
+            fputc('"', output);
+        fputc(*c, output);
+    }
+    fputc('"', output);
+}
+
+static void Sweep_Write_Results(const Sweep_Spec *spec, Sweep_Context *context, int num_of_jobs, FILE *output) {  /* A CSV row per configuration, in the order of the grid */
+    fprintf(output, "algorithm,frames,q,ws_size,loads,saves,page_faults,references,used_frames");
+    for (int pid = 0; pid < spec->num_of_processes; pid++) {
+        char name[64];
+        Process_Name(name, sizeof(name), spec->trace_paths[pid]);
+        fprintf(output, ",%s_faults", name);
+    }
+    fprintf(output, ",status\n");
+    for (int i = 0; i < num_of_jobs; i++) {
+        Sweep_Job *job = &context->jobs[i];
+        fprintf(output, "%s,%d,%d,", Algorithm_Name(job->algorithm), job->num_of_frames, job->q);
+        if (job->ws_size != INVALID)
+            fprintf(output, "%d", job->ws_size);
+        if (job->status != OK) {
+            fprintf(output, ",,,,,");
+            for (int pid = 0; pid < spec->num_of_processes; pid++) {
+                fprintf(output, ",");
+            }
+            fprintf(output, ",");
+            Sweep_Write_Quoted(output, job->error);
+            fprintf(output, "\n");
+            continue;
+        }
+        long long page_faults = 0;
+        for (int pid = 0; pid < spec->num_of_processes; pid++) {
+            page_faults += job->page_faults[pid];
+        }
+        fprintf(output, ",%lld,%lld,%lld,%lld,%d", job->load_count, job->save_count, page_faults, job->reference_count, job->used_frames);
+        for (int pid = 0; pid < spec->num_of_processes; pid++) {
+            fprintf(output, ",%lld", job->page_faults[pid]);
+        }
+        fprintf(output, ",ok\n");
+    }
+}
+
+int Sweep_Run(const Sweep_Spec *spec) {  /* Simulate every configuration and write a CSV row for each one (OK or ERROR) */
+    Sweep_Context context;
+    context.spec = spec;
+    
+    /* Build the grid */
+    long long num_of_configurations = 0;
+    for (int a = 0; a < spec->num_of_algorithms; a++) {
+        long long grid = (long long)spec->num_of_frames_values * spec->num_of_q_values;  /* Cannot wrap, both counts are ints */
+        if (grid <= INT_MAX)
+            grid *= Algorithm_Uses_Working_Sets(spec->algorithms[a]) ? spec->num_of_ws_sizes : 1;
+        num_of_configurations += (grid <= INT_MAX) ? grid : (long long)INT_MAX + 1;  /* Enough to get rejected, without wrapping */
+    }
+    if (num_of_configurations > INT_MAX) {
+        printf("The sweep has too many configurations (at most %d can be simulated)\n", INT_MAX);
+        return ERROR;
+    }
+    int num_of_jobs = (int)num_of_configurations;
+    context.jobs = (Sweep_Job *)calloc((size_t)num_of_jobs, sizeof(Sweep_Job));
+    long long *page_faults = (long long *)calloc((size_t)num_of_jobs * spec->num_of_processes, sizeof(long long));
+    context.traces = (Trace_Data *)calloc(spec->num_of_processes, sizeof(Trace_Data));
+    if (context.jobs == NULL || page_faults == NULL || context.traces == NULL) {
+        printf("An error occured during memory allocation\n");
+        free(context.jobs);
+        free(page_faults);
+        free(context.traces);
+        return ERROR;
+    }
+    int job = 0;
+    for (int a = 0; a < spec->num_of_algorithms; a++) {
+        bool uses_working_sets = Algorithm_Uses_Working_Sets(spec->algorithms[a]);
+        for (int f = 0; f < spec->num_of_frames_values; f++) {
+            for (int q = 0; q < spec->num_of_q_values; q++) {
+                for (int w = 0; w < (uses_working_sets ? spec->num_of_ws_sizes : 1); w++, job++) {
+                    context.jobs[job].algorithm = spec->algorithms[a];
+                    context.jobs[job].num_of_frames = spec->frames[f];
+                    context.jobs[job].q = spec->q_values[q];
+                    context.jobs[job].ws_size = uses_working_sets ? spec->ws_sizes[w] : INVALID;
+                    context.jobs[job].page_faults = page_faults + (size_t)job * spec->num_of_processes;
+                }
+            }
+        }
+    }
+    
+    /* Parse the traces once */
+    int status = OK;
+    for (int pid = 0; pid < spec->num_of_processes && status == OK; pid++) {
+        if (Trace_Load(&context.traces[pid], spec->trace_paths[pid], &spec->layout) != OK) {
+            printf("Could not read file %s\n", spec->trace_paths[pid]);
+            status = ERROR;
+        }
+    }
+    
+    /* Deal the jobs to the workers and run them */
+    if (status == OK) {
+        context.num_of_workers = (spec->num_of_threads > 0) ? spec->num_of_threads : (int)sysconf(_SC_NPROCESSORS_ONLN);
+        if (context.num_of_workers < 1)
+            context.num_of_workers = 1;
+        if (context.num_of_workers > num_of_jobs)
+            context.num_of_workers = num_of_jobs;
+        context.queues = (Work_Queue *)calloc(context.num_of_workers, sizeof(Work_Queue));
+        int *queued_jobs = (int *)malloc((size_t)num_of_jobs * sizeof(int));
+        pthread_t *threads = (pthread_t *)calloc(context.num_of_workers, sizeof(pthread_t));
+        Worker *workers = (Worker *)calloc(context.num_of_workers, sizeof(Worker));
+        if (context.queues == NULL || queued_jobs == NULL || threads == NULL || workers == NULL) {
+            printf("An error occured during memory allocation\n");
+            status = ERROR;
+        }
+        else {
+            for (int i = 0; i < num_of_jobs; i++) {
+                queued_jobs[i] = i;
+            }
+            for (int w = 0; w < context.num_of_workers; w++) {  /* A contiguous share of the grid each */
+                pthread_mutex_init(&context.queues[w].lock, NULL);
+                context.queues[w].jobs = queued_jobs;
+                context.queues[w].front = (int)((long long)num_of_jobs * w / context.num_of_workers);
+                context.queues[w].back = (int)((long long)num_of_jobs * (w + 1) / context.num_of_workers);
+                workers[w].context = &context;
+                workers[w].id = w;
+            }
+            int started = 0;
+            for (; started < context.num_of_workers; started++) {
+                if (pthread_create(&threads[started], NULL, Sweep_Worker, &workers[started]) != 0)
+                    break;  /* The threads that did start will steal the jobs of the rest */
+            }
+            if (started == 0)
+                Sweep_Worker(&workers[0]);  /* No thread at all, so do everything here */
+            for (int w = 0; w < started; w++) {
+                pthread_join(threads[w], NULL);
+            }
+            for (int w = 0; w < context.num_of_workers; w++) {
+                pthread_mutex_destroy(&context.queues[w].lock);
+            }
+        }
+        free(context.queues);
+        free(queued_jobs);
+        free(threads);
+        free(workers);
+    }
+    
+    if (status == OK) {
+        FILE *output = (spec->output_path != NULL) ? fopen(spec->output_path, "w") : stdout;
+        if (output == NULL) {
+            printf("Could not create file %s\n", spec->output_path);
+            status = ERROR;
+        }
+        else {
+            Sweep_Write_Results(spec, &context, num_of_jobs, output);
+            if (output != stdout && fclose(output) != 0)
+                status = ERROR;
+        }
+    }
+    for (int pid = 0; pid < spec->num_of_processes; pid++) {
+        Trace_Unload(&context.traces[pid]);
+    }
+    free(context.traces);
+    free(page_faults);
+    free(context.jobs);
+    return status;
+}
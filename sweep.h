@@ -0,0 +1,30 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include "simulator.h"
+
+/* Parameter sweep: every combination of algorithm x num_of_frames x q x ws_size is simulated on the same traces.
+   The traces are parsed once and shared (read only) by all the simulations, which run on a pool of threads.
+   Each thread starts with its own share of the configurations and steals from the others when it runs out. */
+
+typedef struct Sweep_Spec_Type {  /* The grid of configurations and how to run it */
+    Algorithm *algorithms;
+    int num_of_algorithms;
+    int *frames;  /* The values of num_of_frames */
+    int num_of_frames_values;
+    int *q_values;
+    int num_of_q_values;
+    int *ws_sizes;  /* Used only by the WS algorithm */
+    int num_of_ws_sizes;
+    long long max_num_of_references;  /* INVALID for no limit */
+    Address_Layout layout;
+    const char **trace_paths;
+    int num_of_processes;
+    int num_of_threads;  /* 0 to use every online processor */
+    const char *output_path;  /* Where to write the result rows (NULL for standard output) */
+} Sweep_Spec;
+
+int Sweep_Parse_List(const char *text, int **values, int *count);  /* Parse "a,b,c" and/or "start:end:step" items into a new array (OK, or ERROR with *values NULL) */
+int Sweep_Run(const Sweep_Spec *spec);  /* Simulate every configuration and write a CSV row for each one (OK or ERROR) */
+
+#endif
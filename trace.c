@@ -0,0 +1,520 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "ergasia2.h"
+#include "trace.h"
+#include "stream.h"
+
+static bool Trace_Fill_Buffer(Trace_Reader *reader);
+static void Trace_Fill_At_Least(Trace_Reader *reader, size_t size);
+
+static const int8_t hex_digit_value[256] = {  /* The value of each ASCII hex digit (-1 for any other character) */
+    [0 ... 255] = -1,
+    ['0'] = 0, ['1'] = 1, ['2'] = 2, ['3'] = 3, ['4'] = 4, ['5'] = 5, ['6'] = 6, ['7'] = 7, ['8'] = 8, ['9'] = 9,
+    ['a'] = 10, ['b'] = 11, ['c'] = 12, ['d'] = 13, ['e'] = 14, ['f'] = 15,
+    ['A'] = 10, ['B'] = 11, ['C'] = 12, ['D'] = 13, ['E'] = 14, ['F'] = 15
+};
+
+static uint32_t Read_U32(const unsigned char *bytes) {  /* Decode a little-endian 32-bit field */
+    return bytes[0] | (uint32_t)bytes[1] << 8 | (uint32_t)bytes[2] << 16 | (uint32_t)bytes[3] << 24;
+}
+
+static uint64_t Read_U64(const unsigned char *bytes) {  /* Decode a little-endian 64-bit field */
+    return Read_U32(bytes) | (uint64_t)Read_U32(bytes + 4) << 32;
+}
+
+static void Write_U32(unsigned char *bytes, uint32_t value) {  /* Encode a little-endian 32-bit field */
+    for (int i = 0; i < 4; i++) {
+        bytes[i] = value >> (8 * i);
+    }
+}
+
+static void Write_U64(unsigned char *bytes, uint64_t value) {  /* Encode a little-endian 64-bit field */
+    Write_U32(bytes, (uint32_t)value);
+    Write_U32(bytes + 4, (uint32_t)(value >> 32));
+}
+
+static int Write_Varint(unsigned char *bytes, uint64_t value) {  /* Encode 7 bits per byte, least significant first, and return the number of bytes */
+    int length = 0;
+    while (value >= 0x80) {
+        bytes[length++] = (value & 0x7F) | 0x80;  /* The high bit shows that more bytes follow */
+        value >>= 7;
+    }
+    bytes[length++] = value;
+    return length;
+}
+
+static bool Read_Varint(const unsigned char **bytes, const unsigned char *end, uint64_t *value) {  /* Decode a varint that ends before end and advance past it (FALSE if it is cut short) */
+    *value = 0;
+    for (int shift = 0; *bytes < end; shift += 7) {
+        unsigned char byte = *(*bytes)++;
+        *value |= (uint64_t)(byte & 0x7F) << shift;
+        if (byte < 0x80 || shift >= 63)
+            return TRUE;
+    }
+    return FALSE;
+}
+
+static bool Trace_Parse_Header(Trace_Reader *reader, const unsigned char *bytes, size_t size) {  /* Recognize the header of a binary trace (FALSE for a text trace) */
+    if (size < TRACE_HEADER_SIZE || memcmp(bytes, TRACE_MAGIC, 8) != 0)
+        return FALSE;
+    Trace_Header *header = &reader->header;
+    header->version = Read_U32(bytes + 8);
+    header->encoding = Read_U32(bytes + 12);
+    header->offset_bits = Read_U32(bytes + 16);
+    header->address_digits = Read_U32(bytes + 20);
+    header->num_of_references = Read_U64(bytes + 24);
+    header->data_offset = Read_U64(bytes + 32);
+    header->index_offset = Read_U64(bytes + 40);
+    header->num_of_index_entries = Read_U64(bytes + 48);
+    header->index_interval = Read_U32(bytes + 56);
+    reader->binary = TRUE;
+    reader->references_left = header->num_of_references;
+    reader->previous_page = 0;
+    return TRUE;
+}
+
+static bool Trace_Header_Valid(const Trace_Header *header, uint64_t file_size) {  /* Whether a header can be trusted to decode the records (file_size is UINT64_MAX if it is not known) */
+    if (header->version != TRACE_VERSION || (header->encoding != TRACE_FIXED && header->encoding != TRACE_DELTA_VARINT))
+        return FALSE;
+    if (header->offset_bits > MAX_OFFSET_BITS)
+        return FALSE;  /* Page numbers are shifted by it */
+    return (header->data_offset >= TRACE_HEADER_SIZE && header->data_offset <= header->index_offset && header->index_offset <= file_size);  /* Header, records and index follow each other */
+}
+
+int Address_Layout_Init(Address_Layout *layout, uint64_t page_size, int address_bits) {  /* Derive the shifts and masks of a page size and an address width (OK or ERROR) */
+    if (page_size == 0 || (page_size & (page_size - 1)) != 0 || address_bits > 64)
+        return ERROR;  /* The offset has to be a whole number of bits */
+    layout->offset_bits = __builtin_ctzll(page_size);
+    if (layout->offset_bits > MAX_OFFSET_BITS)
+        return ERROR;  /* Its offsets would not fit in a Reference */
+    if (address_bits <= layout->offset_bits)
+        return ERROR;  /* Not a single bit would be left for the page number */
+    layout->address_bits = address_bits;
+    layout->offset_mask = page_size - 1;
+    layout->address_mask = (address_bits == 64) ? UINT64_MAX : ((uint64_t)1 << address_bits) - 1;
+    return OK;
+}
+
+int Trace_Open(Trace_Reader *reader, const char *path, const Address_Layout *layout) {  /* Prepare a trace for reading (OK or ERROR) */
+    memset(reader, 0, sizeof(Trace_Reader));
+    reader->layout = *layout;
+    reader->wake_fd = INVALID;
+    if (Stream_Wanted(path))  /* The standard input, a command or a compressed file */
+        return Stream_Open(reader, path, INVALID);
+    reader->fd = open(path, O_RDONLY);
+    if (reader->fd < 0)
+        return ERROR;
+    struct stat info;
+    if (fstat(reader->fd, &info) == 0 && S_ISREG(info.st_mode)) {  /* A regular file can be mapped */
+        if (info.st_size == 0) {  /* Nothing to map (an empty trace) */
+            reader->end_of_file = TRUE;
+            return OK;
+        }
+        void *map = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, reader->fd, 0);
+        if (map != MAP_FAILED) {
+            madvise(map, info.st_size, MADV_SEQUENTIAL);  /* Let the kernel read ahead aggressively */
+            reader->map = (char *)map;
+            reader->map_size = info.st_size;
+            reader->position = reader->map;
+            reader->end = reader->map + reader->map_size;
+            reader->end_of_file = TRUE;  /* The whole file is already available */
+            if (Trace_Parse_Header(reader, (const unsigned char *)reader->map, reader->map_size)) {
+                if (!Trace_Header_Valid(&reader->header, reader->map_size)) {
+                    Trace_Close(reader);
+                    return ERROR;
+                }
+                reader->position = reader->map + reader->header.data_offset;  /* Skip the header */
+                reader->end = reader->map + reader->header.index_offset;  /* The index is not part of the records */
+            }
+            return OK;
+        }
+    }
+    return Stream_Open(reader, path, reader->fd);  /* Pipes and terminals (or a file that could not be mapped) get a reader thread */
+}
+
+int Trace_Open_Descriptor(Trace_Reader *reader, int fd, const Address_Layout *layout) {  /* Prepare for parsing the trace that an open file descriptor streams, in the calling thread (OK or ERROR) */
+    memset(reader, 0, sizeof(Trace_Reader));
+    reader->layout = *layout;
+    reader->fd = fd;
+    reader->wake_fd = INVALID;
+    reader->buffer = (char *)malloc(TRACE_STREAM_BUFFER_SIZE);
+    if (reader->buffer == NULL) {
+        close(reader->fd);
+        return ERROR;
+    }
+    reader->position = reader->end = reader->buffer;
+    Trace_Fill_At_Least(reader, TRACE_HEADER_SIZE);  /* Peek at the start of the stream to recognize a binary trace */
+    if (Trace_Parse_Header(reader, (const unsigned char *)reader->position, reader->end - reader->position)) {
+        if (reader->header.data_offset <= TRACE_STREAM_BUFFER_SIZE)
+            Trace_Fill_At_Least(reader, reader->header.data_offset);
+        if (!Trace_Header_Valid(&reader->header, UINT64_MAX) || reader->header.data_offset > (size_t)(reader->end - reader->position)) {  /* The size of the stream is not known, but its header has to be there */
+            Trace_Close(reader);
+            return ERROR;
+        }
+        reader->position += reader->header.data_offset;  /* Skip the header (the index at the end is never reached, since the records are counted) */
+    }
+    return OK;
+}
+
+void Trace_Close(Trace_Reader *reader) {  /* Release everything that belongs to a trace */
+    if (reader->stream != NULL)
+        Stream_Close(reader->stream);
+    if (reader->map != NULL)
+        munmap(reader->map, reader->map_size);
+    free(reader->buffer);
+    if (reader->fd != INVALID)
+        close(reader->fd);
+}
+
+static bool Trace_Fill_Buffer(Trace_Reader *reader) {  /* Keep the unparsed characters of a streamed file and append what a single read() returns (FALSE if nothing more can be added) */
+    if (reader->end_of_file)
+        return FALSE;
+    size_t leftover = reader->end - reader->position;  /* A line that was cut in half by the previous chunk */
+    if (reader->position != reader->buffer) {
+        memmove(reader->buffer, reader->position, leftover);
+        reader->position = reader->buffer;
+        reader->end = reader->buffer + leftover;
+    }
+    if (reader->end == reader->buffer + TRACE_STREAM_BUFFER_SIZE)
+        return FALSE;  /* A single line fills the whole buffer */
+    if (reader->wake_fd != INVALID) {  /* Wait for input or for the order to stop, whichever comes first */
+        struct pollfd descriptors[2] = { { reader->fd, POLLIN, 0 }, { reader->wake_fd, POLLIN, 0 } };
+        while (poll(descriptors, 2, -1) < 0 && errno == EINTR)
+            ;
+        if (descriptors[1].revents != 0) {
+            reader->end_of_file = TRUE;  /* Whatever is left of the input is not wanted any more */
+            return TRUE;
+        }
+    }
+    ssize_t count;
+    do {
+        count = read(reader->fd, (char *)reader->end, reader->buffer + TRACE_STREAM_BUFFER_SIZE - reader->end);
+    } while (count < 0 && errno == EINTR);
+    if (count <= 0)
+        reader->end_of_file = TRUE;  /* End of file (or an error, which ends the trace aswell) */
+    else
+        reader->end += count;
+    return TRUE;
+}
+
+static void Trace_Fill_At_Least(Trace_Reader *reader, size_t size) {  /* Read until size unparsed bytes are available (or the file ends) */
+    while ((size_t)(reader->end - reader->position) < size && Trace_Fill_Buffer(reader))
+        ;
+}
+
+static bool Trace_Needs_Input(const Trace_Reader *reader) {  /* Whether less than a whole record (or line) is left unparsed */
+    size_t available = reader->end - reader->position;
+    if (reader->end_of_file)
+        return FALSE;
+    if (reader->binary)
+        return (available < TRACE_MAX_RECORD_SIZE);
+    return (memchr(reader->position, '\n', available) == NULL);
+}
+
+Reference TranslateBuffer(const char *line, const char *end, const Address_Layout *layout) {  /* Extract a reference from a line (end points right after the line, at its end of line) */
+    Reference reference;  /* A reference consists of page number, offset and action */
+    const unsigned char *c = (const unsigned char *)line;
+    uint64_t address = 0;
+    int num_of_digits = 0;
+    for (; c < (const unsigned char *)end && hex_digit_value[*c] >= 0; c++, num_of_digits++) {
+        address = (address << 4) | hex_digit_value[*c];  /* Convert the hex representation of the logical address (of any width) */
+    }
+    reference.page_num = address >> layout->offset_bits;  /* The high bits of the address form the page number */
+    reference.offset = address & layout->offset_mask;  /* The low bits form the offset */
+    while (c < (const unsigned char *)end && (*c == ' ' || *c == '\t'))
+        c++;  /* Skip the space between the address and the action */
+    bool valid_address = (num_of_digits > 0 && num_of_digits <= 16 && (address & ~layout->address_mask) == 0);  /* It fits in 64 bits and in the logical address space */
+    reference.action = (valid_address && c < (const unsigned char *)end) ? *c : '\0';  /* A line without a valid address or an action is invalid */
+    reference.text = line;
+    reference.text_length = end - line;
+    if (reference.text_length > 0 && line[reference.text_length - 1] == '\r')
+        reference.text_length--;  /* Do not show the carriage return of a CRLF end of line */
+    return reference;
+}
+
+static int Trace_Decode_Batch(Trace_Reader *reader, Reference *batch, int max_length) {  /* Decode up to max_length records of a binary trace */
+    const unsigned char *position = (const unsigned char *)reader->position;
+    const unsigned char *end = (const unsigned char *)reader->end;
+    int header_offset_bits = reader->header.offset_bits;
+    const Address_Layout *layout = &reader->layout;
+    int length = 0;
+    while (length < max_length && reader->references_left > 0) {
+        if (end - position < TRACE_MAX_RECORD_SIZE && !reader->end_of_file)
+            break;  /* The record may continue in the next chunk */
+        uint64_t address, flags;
+        if (reader->header.encoding == TRACE_FIXED) {
+            if (end - position < 8)
+                break;  /* Truncated trace */
+            uint64_t record = Read_U64(position);
+            position += 8;
+            address = record >> 1;
+            flags = record;
+        }
+        else {
+            const unsigned char *record = position;
+            uint64_t zigzag;
+            if (!Read_Varint(&position, end, &zigzag) || !Read_Varint(&position, end, &flags)) {  /* flags: offset << 1 | is_write */
+                position = record;
+                break;  /* Truncated trace */
+            }
+            reader->previous_page += (zigzag >> 1) ^ -(zigzag & 1);  /* Undo the zigzag encoding of the (signed) delta */
+            address = reader->previous_page << header_offset_bits | flags >> 1;
+        }
+        Reference *reference = &batch[length++];
+        reference->page_num = address >> layout->offset_bits;  /* Split the address again, in case the pages of the simulation differ from those of the records */
+        reference->offset = address & layout->offset_mask;
+        reference->action = ((address & ~layout->address_mask) != 0) ? '\0' : (flags & 1) ? 'W' : 'R';  /* An address outside the logical address space is invalid */
+        reference->text = NULL;  /* The reference is shown from its fields instead */
+        reference->text_length = reader->header.address_digits;
+        reader->references_left--;
+    }
+    reader->position = (const char *)position;
+    return length;
+}
+
+int Trace_Read_Batch(Trace_Reader *reader, Reference *batch, int max_length) {  /* Parse up to max_length references into batch and return how many there were (0 at the end of the trace) */
+    if (reader->stream != NULL)
+        return Stream_Read_Batch(reader->stream, batch, max_length);  /* Already parsed by the reader thread */
+    if (reader->buffer != NULL) {
+        while (Trace_Needs_Input(reader) && Trace_Fill_Buffer(reader))
+            ;  /* The previous batch has been used up, so what is left of the buffer can be moved to its start */
+    }
+    if (reader->binary)
+        return Trace_Decode_Batch(reader, batch, max_length);  /* At least TRACE_MAX_RECORD_SIZE bytes are available until the end of file */
+    int length = 0;
+    for (;;) {
+        while (length < max_length && reader->position < reader->end) {
+            const char *line = reader->position;
+            const char *line_end = memchr(line, '\n', reader->end - line);
+            if (line_end == NULL) {  /* The last line of what is available has no end of line */
+                if (!reader->end_of_file && (line != reader->buffer || reader->end < reader->buffer + TRACE_STREAM_BUFFER_SIZE))
+                    break;  /* The rest of the line has not been read yet, so leave it for the next chunk */
+                line_end = reader->end;  /* Missing final newline (or a line longer than the whole buffer) */
+                reader->position = reader->end;
+            }
+            else
+                reader->position = line_end + 1;  /* Skip the end of line */
+            const char *c = line;
+            while (c < line_end && (*c == ' ' || *c == '\t' || *c == '\r'))
+                c++;
+            if (c == line_end)
+                continue;  /* Ignore blank lines */
+            batch[length++] = TranslateBuffer(line, line_end, &reader->layout);
+        }
+        if (length > 0 || reader->buffer == NULL || (reader->end_of_file && reader->position == reader->end))
+            break;
+        while (Trace_Needs_Input(reader) && Trace_Fill_Buffer(reader))
+            ;  /* Only blank lines or a partial line were available, and nothing refers to them yet */
+    }
+    return length;
+}
+
+int Trace_Load(Trace_Data *data, const char *path, const Address_Layout *layout) {  /* Parse a whole trace into memory (OK or ERROR) */
+    data->references = NULL;
+    data->num_of_references = 0;
+    data->reader = (Trace_Reader *)malloc(sizeof(Trace_Reader));
+    if (data->reader == NULL || Trace_Open(data->reader, path, layout) != OK) {
+        free(data->reader);
+        data->reader = NULL;
+        return ERROR;
+    }
+    long long capacity = 0;
+    for (;;) {
+        if (data->num_of_references + TRACE_BATCH_SIZE > capacity) {  /* Make room for a whole batch */
+            capacity = (capacity == 0) ? (1 << 16) : 2 * capacity;
+            Reference *larger = (Reference *)realloc(data->references, capacity * sizeof(Reference));
+            if (larger == NULL) {
+                Trace_Unload(data);
+                return ERROR;
+            }
+            data->references = larger;
+        }
+        int length = Trace_Read_Batch(data->reader, data->references + data->num_of_references, TRACE_BATCH_SIZE);
+        if (length == 0)
+            break;
+        if (data->reader->map == NULL) {  /* The text of a streamed trace is about to be overwritten, so keep just the width of the address */
+            for (int i = 0; i < length; i++) {
+                Reference *reference = &data->references[data->num_of_references + i];
+                if (reference->text != NULL) {
+                    int num_of_digits = 0;
+                    while (num_of_digits < reference->text_length && hex_digit_value[(unsigned char)reference->text[num_of_digits]] >= 0)
+                        num_of_digits++;
+                    reference->text = NULL;
+                    reference->text_length = num_of_digits;
+                }
+            }
+        }
+        data->num_of_references += length;
+    }
+    if (data->reader->map == NULL) {  /* Nothing points into the reader any more */
+        Trace_Close(data->reader);
+        free(data->reader);
+        data->reader = NULL;
+    }
+    return OK;
+}
+
+void Trace_Unload(Trace_Data *data) {  /* Release a trace that was parsed into memory */
+    free(data->references);
+    if (data->reader != NULL) {
+        Trace_Close(data->reader);
+        free(data->reader);
+    }
+    data->references = NULL;
+    data->reader = NULL;
+}
+
+int Trace_Seek(Trace_Reader *reader, uint64_t reference_index) {  /* Position a freshly opened trace at the given reference, so it is the next one handed out (OK or ERROR) */
+    reader->batch_length = reader->batch_next = 0;  /* Nothing that was parsed before is handed out any more */
+    uint64_t skipped = 0;
+    if (reader->binary && reader->map != NULL && reader->header.num_of_index_entries > 0) {  /* Jump to the closest entry of the index */
+        if (reference_index > reader->header.num_of_references || reader->header.index_interval == 0)
+            return ERROR;
+        uint64_t entry = reference_index / reader->header.index_interval;
+        if (entry >= reader->header.num_of_index_entries)
+            entry = reader->header.num_of_index_entries - 1;
+        if (entry >= (reader->map_size - reader->header.index_offset) / TRACE_INDEX_ENTRY_SIZE)
+            return ERROR;  /* The index is cut short */
+        const unsigned char *bytes = (const unsigned char *)reader->map + reader->header.index_offset + entry * TRACE_INDEX_ENTRY_SIZE;
+        uint64_t record_offset = Read_U64(bytes);
+        if (record_offset < reader->header.data_offset || record_offset >= reader->header.index_offset)
+            return ERROR;  /* The entry points outside the records */
+        reader->position = reader->map + record_offset;
+        reader->previous_page = Read_U64(bytes + 8);
+        skipped = entry * reader->header.index_interval;
+        reader->references_left = reader->header.num_of_references - skipped;
+    }
+    else if (!reader->binary && reader->map != NULL) {  /* Count lines without parsing them */
+        for (; skipped < reference_index && reader->position < reader->end; ) {
+            const char *line_end = memchr(reader->position, '\n', reader->end - reader->position);
+            const char *c = reader->position;
+            while (c < (line_end ? line_end : reader->end) && (*c == ' ' || *c == '\t' || *c == '\r'))
+                c++;
+            if (c != (line_end ? line_end : reader->end))
+                skipped++;  /* Blank lines are not references */
+            reader->position = line_end ? line_end + 1 : reader->end;
+        }
+    }
+    while (skipped < reference_index) {  /* Decode and throw away whatever cannot be jumped over */
+        uint64_t remaining = reference_index - skipped;
+        int length = Trace_Read_Batch(reader, reader->batch, remaining < TRACE_BATCH_SIZE ? remaining : TRACE_BATCH_SIZE);
+        if (length == 0)
+            return ERROR;  /* The trace is shorter than that */
+        skipped += length;
+    }
+    return OK;
+}
+
+static void Trace_Print_Reference(const Reference *reference, int offset_bits) {  /* Show a reference as a line of its trace */
+    if (reference->text != NULL)
+        fwrite(reference->text, 1, reference->text_length, stdout);
+    else  /* The input is a binary trace itself, so rebuild its line */
+        printf("%0*" PRIx64 " %c", reference->text_length, (reference->page_num << offset_bits) | (uint64_t)reference->offset, reference->action);
+    printf("\n");
+}
+
+int Trace_Convert(const char *text_path, const char *binary_path, const Address_Layout *layout, Trace_Encoding encoding) {  /* Write the binary form of a text trace (OK or ERROR) */
+    int offset_bits = layout->offset_bits;
+    Trace_Reader *reader = (Trace_Reader *)malloc(sizeof(Trace_Reader));  /* Too big for the stack */
+    if (reader == NULL || Trace_Open(reader, text_path, layout) != OK) {
+        free(reader);
+        return ERROR;
+    }
+    FILE *output = fopen(binary_path, "wb");
+    size_t index_capacity = 1024, num_of_index_entries = 0;
+    unsigned char *index = (unsigned char *)malloc(index_capacity * TRACE_INDEX_ENTRY_SIZE);  /* Kept in memory, it is written after the records */
+    if (output == NULL || index == NULL) {
+        printf("Could not create file %s\n", binary_path);
+        Trace_Close(reader);
+        free(reader);
+        free(index);
+        return ERROR;
+    }
+    unsigned char header[TRACE_HEADER_SIZE] = {0};
+    fwrite(header, TRACE_HEADER_SIZE, 1, output);  /* Placeholder, the header is known only in the end */
+    uint64_t file_offset = TRACE_HEADER_SIZE, num_of_references = 0, previous_page = 0;
+    uint32_t address_digits = 0;
+    int status = OK;
+    Reference *reference;
+    while ((reference = Trace_Next(reader)) != NULL) {
+        if (reference->action != 'R' && reference->action != 'W') {
+            printf("Invalid reference detected in file %s: ", text_path);
+            Trace_Print_Reference(reference, offset_bits);
+            status = ERROR;
+            break;
+        }
+        if (num_of_references == 0) {  /* Every line of a trace has the same width */
+            if (reference->text == NULL)
+                address_digits = reference->text_length;  /* Already known for a binary trace */
+            else {
+                while (address_digits < (uint32_t)reference->text_length && hex_digit_value[(unsigned char)reference->text[address_digits]] >= 0)
+                    address_digits++;  /* The line is not null-terminated, so it cannot be scanned any further */
+            }
+        }
+        if (num_of_references % TRACE_INDEX_INTERVAL == 0) {  /* Record where this reference starts */
+            if (num_of_index_entries == index_capacity) {
+                index_capacity *= 2;
+                unsigned char *larger = (unsigned char *)realloc(index, index_capacity * TRACE_INDEX_ENTRY_SIZE);
+                if (larger == NULL) {
+                    status = ERROR;
+                    break;
+                }
+                index = larger;
+            }
+            Write_U64(index + num_of_index_entries * TRACE_INDEX_ENTRY_SIZE, file_offset);
+            Write_U64(index + num_of_index_entries * TRACE_INDEX_ENTRY_SIZE + 8, previous_page);
+            num_of_index_entries++;
+        }
+        unsigned char record[TRACE_MAX_RECORD_SIZE];
+        int record_length;
+        uint64_t is_write = (reference->action == 'W');
+        uint64_t address = reference->page_num << offset_bits | reference->offset;
+        if (encoding == TRACE_FIXED) {
+            if (address >> 63) {  /* The top bit would be lost */
+                printf("Address too wide for --fixed records in file %s: ", text_path);
+                Trace_Print_Reference(reference, offset_bits);
+                status = ERROR;
+                break;
+            }
+            Write_U64(record, address << 1 | is_write);
+            record_length = 8;
+        }
+        else {
+            int64_t delta = (int64_t)(reference->page_num - previous_page);
+            record_length = Write_Varint(record, ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63));  /* Zigzag, so small negative deltas stay short */
+            record_length += Write_Varint(record + record_length, (uint64_t)reference->offset << 1 | is_write);
+            previous_page = reference->page_num;
+        }
+        fwrite(record, record_length, 1, output);
+        file_offset += record_length;
+        num_of_references++;
+    }
+    fwrite(index, TRACE_INDEX_ENTRY_SIZE, num_of_index_entries, output);
+    memcpy(header, TRACE_MAGIC, 8);
+    Write_U32(header + 8, TRACE_VERSION);
+    Write_U32(header + 12, encoding);
+    Write_U32(header + 16, offset_bits);
+    Write_U32(header + 20, address_digits);
+    Write_U64(header + 24, num_of_references);
+    Write_U64(header + 32, TRACE_HEADER_SIZE);
+    Write_U64(header + 40, file_offset);
+    Write_U64(header + 48, num_of_index_entries);
+    Write_U32(header + 56, TRACE_INDEX_INTERVAL);
+    fseek(output, 0, SEEK_SET);
+    fwrite(header, TRACE_HEADER_SIZE, 1, output);
+    if (fclose(output) != 0)
+        status = ERROR;
+    Trace_Close(reader);
+    free(reader);
+    free(index);
+    return status;
+}
@@ -0,0 +1,114 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Input layer for the trace files. A regular file is mapped to memory and parsed in place, anything else
+   (the standard input, pipes, compressed files and commands) is read in large chunks by a reader thread
+   (see stream.h). Either way the references are handed out in batches, and the text of each reference
+   points straight into the mapping or the batch (no allocation per line).
+
+   Besides the text format ("<hex address> <R or W>" per line), traces may be in a binary format, which is
+   detected by its magic number. All of its fields are little-endian:
+       header (TRACE_HEADER_SIZE bytes): see Trace_Header
+       records: one per reference, either
+           TRACE_FIXED:        u64 (address << 1 | is_write), so addresses are limited to 63 bits
+           TRACE_DELTA_VARINT: varint(zigzag(page_num - previous page_num)), varint(offset << 1 | is_write)
+       index: an entry (u64 file offset of the record, u64 previous page_num) every index_interval references,
+              so decoding can start from any of them */
+
+#define TRACE_BATCH_SIZE 1024  /* The number of references parsed in one go */
+#define TRACE_STREAM_BUFFER_SIZE (1 << 20)  /* The size of each chunk read from a file that cannot be mapped */
+
+#define TRACE_MAGIC "IPTTRACE"  /* The first 8 bytes of a binary trace */
+#define TRACE_VERSION 1
+#define TRACE_HEADER_SIZE 64
+#define TRACE_INDEX_ENTRY_SIZE 16
+#define TRACE_INDEX_INTERVAL 4096  /* The number of references between two consecutive entries of the index */
+#define TRACE_MAX_RECORD_SIZE 20  /* Two varints of 10 bytes at most */
+#define MAX_OFFSET_BITS 30  /* The largest page is 1G, so an offset always fits in the int of a Reference */
+
+typedef enum Trace_Encoding {  /* How the records of a binary trace are stored */
+    TRACE_FIXED,  /* 8 bytes per reference */
+    TRACE_DELTA_VARINT  /* Difference from the previous page number and offset, as variable length integers (usually 3 to 4 bytes per reference) */
+} Trace_Encoding;
+
+typedef struct Trace_Header_Type {  /* The header of a binary trace (the in-memory form of its first TRACE_HEADER_SIZE bytes) */
+    uint32_t version;  /* Bytes 8-11: TRACE_VERSION */
+    uint32_t encoding;  /* Bytes 12-15: Trace_Encoding of the records */
+    uint32_t offset_bits;  /* Bytes 16-19: How page numbers and offsets were split when the records were written */
+    uint32_t address_digits;  /* Bytes 20-23: The number of hex digits of the addresses of the original text trace (used to show references) */
+    uint64_t num_of_references;  /* Bytes 24-31 */
+    uint64_t data_offset;  /* Bytes 32-39: Where the first record starts */
+    uint64_t index_offset;  /* Bytes 40-47: Where the first entry of the index starts */
+    uint64_t num_of_index_entries;  /* Bytes 48-55 */
+    uint32_t index_interval;  /* Bytes 56-59 */
+} Trace_Header;
+
+typedef struct Address_Layout_Type {  /* How a logical address splits into page number and offset (derived once from the page size and the address width) */
+    int offset_bits;  /* The low bits of an address that form the offset (log2 of the page size) */
+    int address_bits;  /* The width of a logical address (the rest of its bits form the page number) */
+    uint64_t offset_mask;  /* The bits of the offset */
+    uint64_t address_mask;  /* The bits a valid address may have */
+} Address_Layout;
+
+typedef struct Reference_Type {  /* Request to perform an action to a specific data of a page */
+    uint64_t page_num;  /* The identifier of the page */
+    int offset;  /* Specify in which point of the page the desired data begins */
+    char action;  /* 'R' stands for READ and 'W' stands for WRITE (Anything else is invalid and will lead to error) */
+    const char *text;  /* The line of the trace that describes this reference (not null-terminated, without the end of line). NULL for a binary trace */
+    int text_length;  /* The number of characters of text (for a binary trace, the number of hex digits to show the address with) */
+} Reference;
+
+typedef struct Trace_Stream_Type Trace_Stream;  /* A reader thread and the batches it has parsed ahead (see stream.h) */
+
+typedef struct Trace_Reader_Type {  /* The state of an open trace file */
+    int fd;  /* File descriptor of the trace (INVALID if its stream owns it) */
+    Address_Layout layout;  /* How the addresses split into page number and offset */
+    char *map;  /* The whole file mapped to memory (NULL if the file is streamed instead) */
+    size_t map_size;  /* The size of the mapping in bytes */
+    char *buffer;  /* The chunk of a streamed file that is being parsed (NULL if the file is mapped) */
+    const char *position;  /* The first character that has not been parsed yet */
+    const char *end;  /* The end of the characters that are available for parsing */
+    bool end_of_file;  /* Nothing is left to read from the file descriptor (what is available is all there is) */
+    int wake_fd;  /* Becomes readable when the reading has to stop before the end of the file (INVALID if it never has to) */
+    Trace_Stream *stream;  /* The reader thread that parses a trace that cannot be mapped (NULL if the trace is mapped or parsed by the caller) */
+    bool binary;  /* The trace is in the binary format (the rest of the fields below apply only then) */
+    Trace_Header header;  /* The header of the binary trace */
+    uint64_t references_left;  /* The number of records that have not been decoded yet */
+    uint64_t previous_page;  /* The page number of the last decoded record (the base of the next delta) */
+    Reference batch[TRACE_BATCH_SIZE];  /* The references of the last parsed batch */
+    int batch_length;  /* The number of references in batch */
+    int batch_next;  /* The next reference of batch to hand out */
+} Trace_Reader;
+
+typedef struct Trace_Data_Type {  /* A whole trace, parsed once and kept in memory */
+    Reference *references;
+    long long num_of_references;
+    Trace_Reader *reader;  /* Kept open while the text of the references points into its mapping (NULL otherwise) */
+} Trace_Data;
+
+int Address_Layout_Init(Address_Layout *layout, uint64_t page_size, int address_bits);  /* Derive the shifts and masks of a page size and an address width (ERROR if the page size is not a power of 2, is larger than 2^MAX_OFFSET_BITS or leaves no bits for the page number) */
+int Trace_Open(Trace_Reader *reader, const char *path, const Address_Layout *layout);  /* Prepare a trace for reading (OK or ERROR). "-" is the standard input and "<command> |" the output of a command */
+int Trace_Open_Descriptor(Trace_Reader *reader, int fd, const Address_Layout *layout);  /* Prepare for parsing the trace that an open file descriptor streams, in the calling thread (OK or ERROR). The descriptor is closed along with the trace (or right away on ERROR) */
+void Trace_Close(Trace_Reader *reader);  /* Release everything that belongs to a trace */
+int Trace_Read_Batch(Trace_Reader *reader, Reference *batch, int max_length);  /* Parse up to max_length references into batch and return how many there were (0 at the end of the trace) */
+int Trace_Load(Trace_Data *data, const char *path, const Address_Layout *layout);  /* Parse a whole trace into memory (OK or ERROR) */
+void Trace_Unload(Trace_Data *data);  /* Release a trace that was parsed into memory */
+int Trace_Seek(Trace_Reader *reader, uint64_t reference_index);  /* Position a freshly opened trace at the given reference, so it is the next one handed out (OK or ERROR) */
+int Trace_Convert(const char *text_path, const char *binary_path, const Address_Layout *layout, Trace_Encoding encoding);  /* Write the binary form of a text trace (OK or ERROR) */
+Reference TranslateBuffer(const char *line, const char *end, const Address_Layout *layout);  /* Extract a reference from a line (end points right after the line, at its end of line). An address wider than the layout allows makes it invalid */
+
+static inline Reference *Trace_Next(Trace_Reader *reader) {  /* Hand out the next reference (NULL at the end of the trace). It stays valid until the current batch is used up */
+    if (reader->batch_next == reader->batch_length) {  /* The batch is used up, so parse the next one */
+        reader->batch_length = Trace_Read_Batch(reader, reader->batch, TRACE_BATCH_SIZE);
+        reader->batch_next = 0;
+        if (reader->batch_length == 0)
+            return NULL;
+    }
+    return &reader->batch[reader->batch_next++];
+}
+
+#endif
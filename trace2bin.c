@@ -0,0 +1,25 @@
+#include <stdio.h>
+#include <string.h>
+#include "ergasia2.h"
+#include "trace.h"
+
+/* Converter from the text format of the traces to the binary one, which ergasia2 recognizes by itself */
+
+#define GIVE_INSTRUCTIONS_AND_STOP {  /* In case of invalid input */  \
+    printf("To convert a text trace to the binary format:\n./trace2bin <text_trace> <binary_trace> [--fixed]\n\n");  \
+    printf("NOTE: By default records are delta-encoded varints, --fixed stores 8 bytes per reference instead\n");  \
+    return ERROR;  \
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 3 || argc > 4 || (argc == 4 && strcmp(argv[3], "--fixed") != 0))  /* Invalid number of arguments or unknown option */
+        GIVE_INSTRUCTIONS_AND_STOP;
+    Trace_Encoding encoding = (argc == 4) ? TRACE_FIXED : TRACE_DELTA_VARINT;
+    Address_Layout layout;
+    Address_Layout_Init(&layout, FRAME_SIZE, 64);  /* Split the addresses the way the simulator does by default, so the deltas are between page numbers (any width is accepted) */
+    if (Trace_Convert(argv[1], argv[2], &layout, encoding) != OK) {
+        printf("Could not convert %s to %s\n", argv[1], argv[2]);
+        return ERROR;
+    }
+    return OK;
+}